@@ -0,0 +1,193 @@
+#include "boot.h"
+#include "expect.h"
+
+#include <stdio.h>
+
+#include <iterator>
+#include <span>
+
+/*
+ * Native simulation of a staged boot graph.
+ *
+ * Models the flight computer bring-up with fake peripherals: the PLL takes a
+ * number of polls to lock, RAM initialization runs while it does, and the
+ * radio depends on a sensor that fails. Checks that independent stages
+ * overlap, that dependents wait for their dependencies and that a failure only
+ * skips what depends on it.
+ */
+
+#define PLL_LOCK_POLLS 50
+
+/* Layout `Profile::Serialize()` documents */
+#define PROFILE_VERSION 1
+#define PROFILE_HEADER_SIZE 2
+#define PROFILE_RECORD_SIZE 9
+
+enum Stage : uint8_t
+{
+    kClocks,
+    kRam,
+    kGpio,
+    kValves,
+    kBarometer,
+    kRadio,
+    kLogger,
+    kStageCount,
+};
+
+static int pll_polls;
+static int ram_polls_while_locking;
+static int order;
+static int started[kStageCount];
+
+static bool Mark(Stage stage)
+{
+    started[stage] = ++order;
+    return true;
+}
+
+static bool StartClocks()
+{
+    pll_polls = 0;
+    return Mark(kClocks);
+}
+
+static boot::Poll PollClocks()
+{
+    return ++pll_polls >= PLL_LOCK_POLLS ? boot::Poll::Ready : boot::Poll::Busy;
+}
+
+static bool StartRam()
+{
+    ram_polls_while_locking = pll_polls;
+    return Mark(kRam);
+}
+
+static bool StartGpio()
+{
+    return Mark(kGpio);
+}
+
+static bool StartValves()
+{
+    return Mark(kValves);
+}
+
+static bool StartBarometer()
+{
+    Mark(kBarometer);
+    return false;
+}
+
+static bool StartRadio()
+{
+    return Mark(kRadio);
+}
+
+static bool StartLogger()
+{
+    return Mark(kLogger);
+}
+
+static const boot::Stage stages[] = {
+    {"Clocks", boot::Phase::Early, 0, StartClocks, PollClocks},
+    {"Ram", boot::Phase::Early, 0, StartRam, NULL},
+    {"Gpio", boot::Phase::Early, boot::After(kClocks), StartGpio, NULL},
+    {"Valves", boot::Phase::Early, boot::After(kGpio, kRam), StartValves, NULL},
+    {"Barometer", boot::Phase::Deferred, boot::After(kGpio), StartBarometer, NULL},
+    {"Radio", boot::Phase::Deferred, boot::After(kBarometer), StartRadio, NULL},
+    {"Logger", boot::Phase::Deferred, boot::After(kRam), StartLogger, NULL},
+};
+
+static uint32_t Get32(const uint8_t *in)
+{
+    uint32_t value = 0;
+    for (unsigned i = 0; i < sizeof(value); i++)
+    {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+/* Decodes the downlink bytes the way the ground does and compares them with the profile they came from */
+static bool CheckDownlink(std::span<const uint8_t> downlink, const boot::Profile &profile)
+{
+    bool ok = Expect(downlink.size() == boot::Profile::SerializedSize(kStageCount), "profile size");
+    ok &= Expect(downlink[0] == PROFILE_VERSION && downlink[1] == profile.count, "profile header");
+    if (!ok)
+    {
+        return false;
+    }
+
+    const uint8_t *cursor = &downlink[PROFILE_HEADER_SIZE];
+    for (const uint32_t mark : profile.reset)
+    {
+        ok &= Expect(Get32(cursor) == mark, "reset mark");
+        cursor += sizeof(mark);
+    }
+    for (size_t i = 0; i < profile.count; i++)
+    {
+        const boot::StageRecord &record = profile.stages[i];
+        const bool same = cursor[0] == static_cast<uint8_t>(record.status) && Get32(&cursor[1]) == record.start &&
+                          Get32(&cursor[1 + sizeof(uint32_t)]) == record.ready;
+        ok &= Expect(same, stages[i].name);
+        cursor += PROFILE_RECORD_SIZE;
+    }
+
+    /* The failed stage must come down as failed, with the time it was tried */
+    const size_t barometer = PROFILE_HEADER_SIZE + sizeof(profile.reset) + kBarometer * PROFILE_RECORD_SIZE;
+    ok &= Expect(downlink[barometer] == static_cast<uint8_t>(boot::Status::Failed) &&
+                     Get32(&downlink[barometer + 1]) == profile.stages[kBarometer].start,
+                 "barometer failure not in the downlink");
+    return ok;
+}
+
+/* Graphs `Validate()` has to reject */
+static bool CheckInvalid()
+{
+    const boot::Stage cycle[] = {
+        {"A", boot::Phase::Early, boot::After(1), StartGpio, NULL},
+        {"B", boot::Phase::Early, boot::After(0), StartGpio, NULL},
+    };
+    const boot::Stage inverted[] = {
+        {"A", boot::Phase::Early, boot::After(1), StartGpio, NULL},
+        {"B", boot::Phase::Deferred, 0, StartGpio, NULL},
+    };
+    const boot::Stage unknown[] = {
+        {"A", boot::Phase::Early, boot::After(5), StartGpio, NULL},
+    };
+
+    bool ok = true;
+    ok &= Expect(!boot::Sequencer(cycle, boot::CycleCount).Validate(), "cycle accepted");
+    ok &= Expect(!boot::Sequencer(inverted, boot::CycleCount).Validate(), "early after deferred accepted");
+    ok &= Expect(!boot::Sequencer(unknown, boot::CycleCount).Validate(), "unknown dependency accepted");
+    return ok;
+}
+
+int main(void)
+{
+    static_assert(std::size(stages) == kStageCount);
+
+    boot::Sequencer sequencer(stages, boot::CycleCount);
+    bool ok = Expect(sequencer.Validate(), "valid graph rejected");
+
+    ok &= Expect(sequencer.Run(boot::Phase::Early), "early phase failed");
+    ok &= Expect(!sequencer.Run(boot::Phase::Deferred), "deferred phase hid a failure");
+    sequencer.Print();
+
+    ok &= Expect(ram_polls_while_locking < PLL_LOCK_POLLS, "ram did not overlap the PLL lock");
+    ok &= Expect(started[kGpio] > started[kClocks] && pll_polls >= PLL_LOCK_POLLS, "gpio started before clocks");
+    ok &= Expect(started[kValves] > started[kGpio] && started[kValves] > started[kRam], "valves out of order");
+    ok &= Expect(sequencer.GetStatus(kBarometer) == boot::Status::Failed, "barometer not failed");
+    ok &= Expect(sequencer.GetStatus(kRadio) == boot::Status::Skipped && started[kRadio] == 0, "radio not skipped");
+    ok &= Expect(sequencer.GetStatus(kLogger) == boot::Status::Done, "logger not run");
+
+    uint8_t downlink[boot::Profile::SerializedSize(kStageCount)];
+    const size_t length = sequencer.GetProfile().Serialize(downlink);
+    ok &= CheckDownlink({downlink, length}, sequencer.GetProfile());
+    printf("profile: %zu bytes\n", length);
+
+    ok &= CheckInvalid();
+    printf("%s\n", ok ? "boot graph ok" : "boot graph FAILED");
+    return ok ? 0 : 1;
+}
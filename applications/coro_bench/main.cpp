@@ -0,0 +1,336 @@
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+
+#include "coro.h"
+#include "expect.h"
+#include "task_stack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <iterator>
+
+/*
+ * Native benchmark for the coroutine executor.
+ *
+ * A top priority "interrupt" task stands in for the peripherals: every driver
+ * request it receives is completed straight away. The same number of drivers
+ * then run the same number of request/complete round trips twice, once as a
+ * blocking task per driver and once as coroutines sharing one executor task,
+ * and the time per round trip and the RAM each approach reserves are compared.
+ * Correctness checks for nesting, failed starts, queued waiters, timeouts,
+ * events and pool exhaustion run first.
+ *
+ * Sizes are for this host: stack words and pointers are twice as wide as on
+ * the flight computer, and the posix port's context switches are far slower.
+ */
+
+#define DRIVERS 4
+#define ROUND_TRIPS 20000
+
+/* What a driver task that only blocks on its HAL calls would be given */
+#define DRIVER_STACK_SIZE 256
+#define EXECUTOR_STACK_SIZE 256
+#define IRQ_STACK_SIZE 256
+#define BENCH_STACK_SIZE 1024
+
+/* Long enough that the first RunOnce(0) after a start cannot time out */
+#define CHECK_TIMEOUT_TICKS pdMS_TO_TICKS(50)
+#define CHECK_WAIT_TICKS pdMS_TO_TICKS(1000)
+
+#define BENCH_PRIORITY 1
+#define DRIVER_PRIORITY 2
+#define IRQ_PRIORITY 3
+
+void BenchTask(void *argument);
+void IrqTask(void *argument);
+void ExecutorTask(void *argument);
+
+struct Request
+{
+    coro::Completion *completion; /* Resumed by the executor, or */
+    TaskHandle_t task;            /* notified directly */
+};
+
+TASK_STACK(BenchTask, BENCH_STACK_SIZE);
+TASK_STACK(IrqTask, IRQ_STACK_SIZE);
+TASK_STACK(ExecutorTask, EXECUTOR_STACK_SIZE);
+static StaticTask_t bench_tcb;
+static StaticTask_t irq_tcb;
+static StaticTask_t executor_tcb;
+
+static StackType_t driver_stacks[DRIVERS][DRIVER_STACK_SIZE];
+static StaticTask_t driver_tcbs[DRIVERS];
+
+static StaticQueue_t request_queue;
+static uint8_t request_buffer[DRIVERS * sizeof(Request)];
+static QueueHandle_t requests;
+
+static coro::Executor executor;
+static coro::Executor check_executor;
+
+static TaskHandle_t bench_task;
+static std::atomic<int> finished;
+static std::atomic<int> failures;
+
+static void Finish()
+{
+    if (++finished == DRIVERS)
+    {
+        xTaskNotifyGive(bench_task);
+    }
+}
+
+void IrqTask(void *argument)
+{
+    (void)argument;
+    Request request;
+
+    for (;;)
+    {
+        xQueueReceive(requests, &request, portMAX_DELAY);
+        if (request.completion != NULL)
+        {
+            request.completion->Complete(coro::Status::Ok);
+        }
+        else
+        {
+            xTaskNotifyGive(request.task);
+        }
+    }
+}
+
+void ExecutorTask(void *argument)
+{
+    (void)argument;
+    executor.Run();
+}
+
+static void DriverTask(void *argument)
+{
+    (void)argument;
+    const Request request = {NULL, xTaskGetCurrentTaskHandle()};
+
+    for (int i = 0; i < ROUND_TRIPS; i++)
+    {
+        xQueueSend(requests, &request, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    Finish();
+    vTaskDelete(NULL);
+}
+
+static coro::Task DriverSequence()
+{
+    coro::Completion completion(executor);
+    const Request request = {&completion, NULL};
+
+    for (int i = 0; i < ROUND_TRIPS; i++)
+    {
+        const coro::Status status =
+            co_await completion.Wait([&request] { return xQueueSend(requests, &request, 0) == pdPASS; });
+        if (status != coro::Status::Ok)
+        {
+            failures++;
+        }
+    }
+    Finish();
+}
+
+template <typename Launch>
+static double NanosecondsPerRoundTrip(Launch launch)
+{
+    finished = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int driver = 0; driver < DRIVERS; driver++)
+    {
+        launch(driver);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (DRIVERS * ROUND_TRIPS);
+}
+
+static coro::Task Child(coro::Completion &completion, int &trace)
+{
+    trace = trace * 10 + 1;
+    const coro::Status status = co_await completion.Wait([] { return true; });
+    trace = trace * 10 + (status == coro::Status::Ok ? 2 : 9);
+}
+
+static coro::Task Parent(coro::Completion &completion, int &trace)
+{
+    const coro::Status status = co_await Child(completion, trace);
+    if (status == coro::Status::Ok)
+    {
+        trace = trace * 10 + 3;
+    }
+}
+
+static coro::Task FailedStart(coro::Completion &completion, coro::Status &status)
+{
+    status = co_await completion.Wait([] { return false; });
+}
+
+static coro::Task CountedStart(coro::Completion &completion, int &starts, coro::Status &status)
+{
+    status = co_await completion.Wait([&starts] {
+        starts++;
+        return true;
+    });
+}
+
+static coro::Task WaitTwice(coro::Event &event, int &count)
+{
+    co_await event;
+    count++;
+    co_await event;
+    count++;
+}
+
+static coro::Task Idle()
+{
+    co_return;
+}
+
+static coro::Task AwaitIdle(coro::Status &status)
+{
+    status = co_await Idle();
+}
+
+static bool CheckExecutor()
+{
+    bool ok = true;
+    coro::Completion completion(check_executor);
+
+    int trace = 0;
+    ok &= Expect(check_executor.Spawn(Parent(completion, trace)), "spawn failed");
+    check_executor.RunOnce(0);
+    ok &= Expect(trace == 1 && completion.Pending(), "child did not suspend");
+    completion.Complete(coro::Status::Ok);
+    check_executor.RunOnce(0);
+    ok &= Expect(trace == 123, "parent did not resume after child");
+    ok &= Expect(coro::FramePool::InUse() == 0, "frames leaked after nesting");
+
+    coro::Status status = coro::Status::Ok;
+    check_executor.Spawn(FailedStart(completion, status));
+    check_executor.RunOnce(0);
+    ok &= Expect(status == coro::Status::Error && !completion.Pending(), "failed start suspended");
+
+    int starts = 0;
+    coro::Status first = coro::Status::Busy;
+    coro::Status second = coro::Status::Busy;
+    check_executor.Spawn(CountedStart(completion, starts, first));
+    check_executor.Spawn(CountedStart(completion, starts, second));
+    check_executor.RunOnce(0);
+    check_executor.RunOnce(0);
+    ok &= Expect(starts == 1 && first == coro::Status::Busy && second == coro::Status::Busy,
+                 "second waiter started while one was in flight");
+    completion.Complete(coro::Status::Ok);
+    check_executor.RunOnce(0);
+    ok &= Expect(first == coro::Status::Ok && starts == 2 && completion.Pending(), "queued waiter not started");
+    completion.Complete(coro::Status::Ok);
+    check_executor.RunOnce(0);
+    ok &= Expect(second == coro::Status::Ok && !completion.Pending(), "queued waiter lost");
+    ok &= Expect(coro::FramePool::InUse() == 0, "frames leaked after queueing");
+
+    /* A peripheral that never interrupts: the executor gives up on it and moves on to the next waiter */
+    int aborts = 0;
+    coro::Completion timed(check_executor, CHECK_TIMEOUT_TICKS, [](void *context) { ++*static_cast<int *>(context); },
+                           &aborts);
+    starts = 0;
+    first = coro::Status::Busy;
+    second = coro::Status::Busy;
+    check_executor.Spawn(CountedStart(timed, starts, first));
+    check_executor.Spawn(CountedStart(timed, starts, second));
+    check_executor.RunOnce(0);
+    check_executor.RunOnce(0);
+    ok &= Expect(!check_executor.RunOnce(0) && first == coro::Status::Busy, "timed out early");
+    check_executor.RunOnce(CHECK_WAIT_TICKS);
+    ok &= Expect(first == coro::Status::Timeout && aborts == 1 && starts == 2, "transfer did not time out");
+    timed.Complete(coro::Status::Ok);
+    check_executor.RunOnce(0);
+    ok &= Expect(second == coro::Status::Ok && !timed.Pending(), "waiter behind a timeout lost");
+    timed.Complete(coro::Status::Error);
+    ok &= Expect(!check_executor.RunOnce(0) && second == coro::Status::Ok, "late completion resumed a waiter");
+    ok &= Expect(coro::FramePool::InUse() == 0, "frames leaked after a timeout");
+
+    coro::Event event(check_executor);
+    int count = 0;
+    event.Set();
+    check_executor.Spawn(WaitTwice(event, count));
+    check_executor.RunOnce(0);
+    ok &= Expect(count == 1 && !check_executor.RunOnce(0), "latched event not consumed once");
+    event.Set();
+    check_executor.RunOnce(0);
+    ok &= Expect(count == 2, "event did not resume waiter");
+
+    coro::Task held[CORO_FRAME_COUNT];
+    for (coro::Task &task : held)
+    {
+        task = Idle();
+        ok &= Expect(static_cast<bool>(task), "pool ran out early");
+    }
+    ok &= Expect(!Idle() && !check_executor.Spawn(Idle()), "allocated past the pool");
+    held[0] = coro::Task();
+    status = coro::Status::Ok;
+    check_executor.Spawn(AwaitIdle(status));
+    check_executor.RunOnce(0);
+    ok &= Expect(status == coro::Status::Error, "child without a frame reported success");
+    for (coro::Task &task : held)
+    {
+        task = coro::Task();
+    }
+    ok &= Expect(coro::FramePool::InUse() == 0, "frames leaked after exhaustion");
+
+    return ok;
+}
+
+void BenchTask(void *argument)
+{
+    (void)argument;
+    bool ok = CheckExecutor();
+
+    const double task_ns = NanosecondsPerRoundTrip([](int driver) {
+        xTaskCreateStatic(DriverTask, "Driver", DRIVER_STACK_SIZE, NULL, DRIVER_PRIORITY, driver_stacks[driver],
+                          &driver_tcbs[driver]);
+    });
+
+    xTaskCreateStatic(ExecutorTask, "Executor", std::size(ExecutorTask_stack), NULL, DRIVER_PRIORITY,
+                      ExecutorTask_stack, &executor_tcb);
+    const double coro_ns = NanosecondsPerRoundTrip([&ok](int driver) {
+        (void)driver;
+        ok &= Expect(executor.Spawn(DriverSequence()), "driver spawn failed");
+    });
+    ok &= Expect(failures == 0, "transfers failed");
+
+    /* The pool is reserved whole however few blocks are used, each sequence then takes a block not its frame size */
+    const size_t frame = coro::FramePool::LargestFrame();
+    const size_t pool_bytes = static_cast<size_t>(CORO_FRAME_COUNT) * CORO_FRAME_SIZE;
+    const size_t per_task = sizeof(driver_stacks[0]) + sizeof(StaticTask_t);
+    const size_t executor_bytes = sizeof(ExecutorTask_stack) + sizeof(StaticTask_t) + sizeof(coro::Executor);
+
+    printf("switch: task per driver %.0f ns, coroutines %.0f ns per round trip\n", task_ns, coro_ns);
+    printf("ram (%d drivers): task per driver %zu bytes, coroutines %zu bytes (executor %zu, pool of %d blocks %zu)\n",
+           DRIVERS, DRIVERS * per_task, executor_bytes + pool_bytes, executor_bytes, CORO_FRAME_COUNT, pool_bytes);
+    printf("ram per extra driver: task %zu bytes, coroutine pool block %d bytes (largest frame %zu)\n", per_task,
+           CORO_FRAME_SIZE, frame);
+    ok &= Expect(frame <= CORO_FRAME_SIZE, "frame larger than a pool block");
+
+    printf("%s\n", ok ? "coroutines ok" : "coroutines FAILED");
+    exit(ok ? 0 : 1);
+}
+
+int main(void)
+{
+    requests = xQueueCreateStatic(DRIVERS, sizeof(Request), request_buffer, &request_queue);
+    bench_task = xTaskCreateStatic(BenchTask, "Bench", std::size(BenchTask_stack), NULL, BENCH_PRIORITY,
+                                   BenchTask_stack, &bench_tcb);
+    xTaskCreateStatic(IrqTask, "Irq", std::size(IrqTask_stack), NULL, IRQ_PRIORITY, IrqTask_stack, &irq_tcb);
+
+    vTaskStartScheduler();
+    return 1;
+}
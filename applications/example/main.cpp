@@ -2,21 +2,68 @@
 #include "portmacro.h"
 #include "task.h"
 
+#include "boot.h"
+#include "params.h"
+#include "stack_monitor.h"
+#include "task_stack.h"
+
 #include <stdbool.h>
 #include <stdio.h>
 
 #include <chrono>
+#include <iterator>
 
 void PrintTask(void *argument);
 
-#define TASK_STACK_SIZE 1024
-#define TASK_STATIC_SIZE 1024
+/* newlib-nano printf plus the exception frame; stack_analysis.py reports printf as a lower bound only */
+#define TASK_STACK_SIZE 256
+#define STACK_REPORT_PERIOD_MS 10000
+
+/* Task stacks and TCBs must not live on main's stack, the scheduler reuses it for interrupts */
+TASK_STACK(PrintTask, TASK_STACK_SIZE);
+static StaticTask_t print_tcb;
+
+static params::Store param_store(params::DefaultStorage());
+
+/* Nothing persisted yet is fine, the compiled-in defaults apply */
+static bool LoadParams()
+{
+    param_store.Load();
+    return true;
+}
+
+static bool CreateTasks()
+{
+    return xTaskCreateStatic(PrintTask, "Print", std::size(PrintTask_stack), NULL, 1, PrintTask_stack, &print_tcb) !=
+           NULL;
+}
+
+static bool StartStackMonitor()
+{
+    stack_monitor::Start(pdMS_TO_TICKS(STACK_REPORT_PERIOD_MS));
+    return true;
+}
+
+enum BootStage : uint8_t
+{
+    kParams,
+    kTasks,
+    kStackMonitor,
+};
+
+static const boot::Stage boot_stages[] = {
+    {"Params", boot::Phase::Early, 0, LoadParams, NULL},
+    {"Tasks", boot::Phase::Early, boot::After(kParams), CreateTasks, NULL},
+    {"StackMonitor", boot::Phase::Deferred, boot::After(kTasks), StartStackMonitor, NULL},
+};
+static boot::Sequencer sequencer(boot_stages, boot::CycleCount);
 
 int main(void)
 {
-    StackType_t task_stack[TASK_STACK_SIZE] = {0};
-    StaticTask_t idk_bruh[TASK_STATIC_SIZE] = {{0}};
-    xTaskCreateStatic(PrintTask, "Print", TASK_STACK_SIZE, NULL, 1, task_stack, idk_bruh);
+    configASSERT(sequencer.Validate());
+    const bool ready = sequencer.Run(boot::Phase::Early);
+    configASSERT(ready);
+    boot::StartDeferred(sequencer);
 
     vTaskStartScheduler();
 
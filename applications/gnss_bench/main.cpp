@@ -0,0 +1,332 @@
+#include "expect.h"
+#include "gnss.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+/*
+ * Native fuzz and throughput harness for the GNSS parser.
+ *
+ * Usage: gnss_bench [capture.bin]
+ *
+ * With no capture a synthetic NMEA/UBX stream is generated. The capture is fed
+ * through the parser in randomly sized chunks (as the UART DMA would deliver
+ * it) to measure throughput, then fed again with random corruption to check
+ * that the parser never desynchronizes for good. The synthetic stream also
+ * has every decoded time, position and velocity compared against what was
+ * encoded.
+ */
+
+#define BENCH_PASSES 20
+#define FUZZ_ROUNDS 200
+#define SYNTHETIC_EPOCHS 20000
+#define MAX_CHUNK 256
+#define GARBAGE_BURST 512
+/* A corrupted UBX length can swallow up to 1 KiB, a handful of epochs */
+#define FUZZ_LOSS_PER_EDIT 12
+#define FUZZ_MAX_EDITS 64
+#define BYTES_PER_MB 1e6
+
+/* UBX framing */
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_CLASS_NAV 0x01
+#define UBX_ID_NAV_PVT 0x07
+#define UBX_HEADER 6
+#define UBX_CHECKSUM 2
+#define NAV_PVT_LENGTH 92
+#define NAV_PVT_VALID_DATE_TIME 0x03U
+#define NAV_PVT_FIX_3D 3U
+#define NAV_PVT_GNSS_FIX_OK 0x01U
+#define BITS_PER_BYTE 8
+
+/*
+ * One epoch per second, starting at midnight. NMEA and UBX report the same
+ * fix: 40 25.68' N, 86 51.78' W, 187 m, 0.486 kn (250 mm/s) heading 90 deg.
+ */
+#define MS_PER_SECOND 1000
+#define SECONDS_PER_MINUTE 60
+#define MINUTES_PER_HOUR 60
+#define SECONDS_PER_HOUR 3600
+#define HOURS_PER_DAY 24
+#define SYNTHETIC_YEAR 2026U
+#define SYNTHETIC_MONTH 10U
+#define SYNTHETIC_DAY 19U
+#define SYNTHETIC_SATELLITES 14U
+#define SYNTHETIC_LONGITUDE_E7 (-868630000)
+#define SYNTHETIC_LATITUDE_E7 404280000
+#define SYNTHETIC_HEIGHT_MM 187000
+#define SYNTHETIC_ACCURACY_MM 1500U
+#define SYNTHETIC_SPEED_MM_S 250U
+#define SYNTHETIC_HEADING_E5 9000000
+/* Each epoch reports the time in RMC and NAV-PVT, the position in GGA and NAV-PVT */
+#define TIMES_PER_EPOCH 2
+#define POSITIONS_PER_EPOCH 2
+
+/* Counts decoded messages, and the ones that differ from the synthetic stream */
+struct CountingListener final : gnss::Listener
+{
+    void OnTime(const gnss::Time &time) override
+    {
+        const auto epoch = static_cast<uint32_t>(times / TIMES_PER_EPOCH % SYNTHETIC_EPOCHS);
+        Check(time.date_valid && time.year == SYNTHETIC_YEAR && time.month == SYNTHETIC_MONTH &&
+              time.day == SYNTHETIC_DAY);
+        Check(time.time_valid && time.hour == epoch / SECONDS_PER_HOUR % HOURS_PER_DAY &&
+              time.minute == epoch / SECONDS_PER_MINUTE % MINUTES_PER_HOUR &&
+              time.second == epoch % SECONDS_PER_MINUTE && time.nanosecond == 0);
+        times++;
+    }
+
+    void OnPosition(const gnss::Position &position) override
+    {
+        Check(position.latitude_e7 == SYNTHETIC_LATITUDE_E7 && position.longitude_e7 == SYNTHETIC_LONGITUDE_E7);
+        Check(position.altitude_mm == SYNTHETIC_HEIGHT_MM && position.fix == gnss::FixType::Fix3D &&
+              position.satellites == SYNTHETIC_SATELLITES);
+        positions++;
+    }
+
+    void OnVelocity(const gnss::Velocity &velocity) override
+    {
+        Check(velocity.ground_speed_mm_s == SYNTHETIC_SPEED_MM_S && velocity.heading_e5 == SYNTHETIC_HEADING_E5);
+        velocities++;
+    }
+
+    void Check(bool matches)
+    {
+        mismatches += matches ? 0 : 1;
+    }
+
+    uint64_t times = 0;
+    uint64_t positions = 0;
+    uint64_t velocities = 0;
+    uint64_t mismatches = 0; /* only meaningful for the synthetic stream */
+};
+
+static void AppendNmea(std::vector<uint8_t> &out, const char *body)
+{
+    uint8_t checksum = 0;
+    for (const char *character = body; *character != '\0'; character++)
+    {
+        checksum ^= static_cast<uint8_t>(*character);
+    }
+
+    char line[128];
+    const int length = snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+    out.insert(out.end(), line, line + length);
+}
+
+/* `value` placed at byte `index` of a little-endian word */
+static constexpr uint32_t AtByte(uint32_t value, int index)
+{
+    return value << (BITS_PER_BYTE * index);
+}
+
+static void AppendNavPvt(std::vector<uint8_t> &out, uint32_t epoch)
+{
+    /* Payload offsets, as in the parser */
+    enum : int
+    {
+        kTimeOfWeek = 0,
+        kDate = 4,
+        kClock = 8,
+        kFix = 20,
+        kLongitude = 24,
+        kLatitude = 28,
+        kHeightMsl = 36,
+        kHorizontalAccuracy = 40,
+        kGroundSpeed = 60,
+        kHeading = 64,
+    };
+
+    uint8_t frame[UBX_HEADER + NAV_PVT_LENGTH + UBX_CHECKSUM] = {UBX_SYNC_1, UBX_SYNC_2, UBX_CLASS_NAV, UBX_ID_NAV_PVT,
+                                                                 NAV_PVT_LENGTH, 0};
+    uint8_t *payload = &frame[UBX_HEADER];
+
+    auto put32 = [payload](int offset, uint32_t value) {
+        for (int i = 0; i < 4; i++)
+        {
+            payload[offset + i] = static_cast<uint8_t>(value >> (BITS_PER_BYTE * i));
+        }
+    };
+    put32(kTimeOfWeek, epoch * MS_PER_SECOND);
+    put32(kDate, SYNTHETIC_YEAR | AtByte(SYNTHETIC_MONTH, 2) | AtByte(SYNTHETIC_DAY, 3));
+    const uint32_t hours = epoch / SECONDS_PER_HOUR % HOURS_PER_DAY;
+    const uint32_t minutes = epoch / SECONDS_PER_MINUTE % MINUTES_PER_HOUR;
+    const uint32_t seconds = epoch % SECONDS_PER_MINUTE;
+    put32(kClock, hours | AtByte(minutes, 1) | AtByte(seconds, 2) | AtByte(NAV_PVT_VALID_DATE_TIME, 3));
+    put32(kFix, NAV_PVT_FIX_3D | AtByte(NAV_PVT_GNSS_FIX_OK, 1) | AtByte(SYNTHETIC_SATELLITES, 3));
+    put32(kLongitude, static_cast<uint32_t>(SYNTHETIC_LONGITUDE_E7));
+    put32(kLatitude, SYNTHETIC_LATITUDE_E7);
+    put32(kHeightMsl, SYNTHETIC_HEIGHT_MM);
+    put32(kHorizontalAccuracy, SYNTHETIC_ACCURACY_MM);
+    put32(kGroundSpeed, SYNTHETIC_SPEED_MM_S);
+    put32(kHeading, SYNTHETIC_HEADING_E5);
+
+    /* Fletcher checksum over class, id, length and payload */
+    uint8_t ck_a = 0;
+    uint8_t ck_b = 0;
+    for (int i = 2; i < UBX_HEADER + NAV_PVT_LENGTH; i++)
+    {
+        ck_a += frame[i];
+        ck_b += ck_a;
+    }
+    frame[UBX_HEADER + NAV_PVT_LENGTH] = ck_a;
+    frame[UBX_HEADER + NAV_PVT_LENGTH + 1] = ck_b;
+    out.insert(out.end(), frame, frame + sizeof(frame));
+}
+
+static std::vector<uint8_t> Synthesize()
+{
+    std::vector<uint8_t> capture;
+    char body[96];
+
+    for (uint32_t epoch = 0; epoch < SYNTHETIC_EPOCHS; epoch++)
+    {
+        const unsigned hours = epoch / SECONDS_PER_HOUR % HOURS_PER_DAY;
+        const unsigned minutes = epoch / SECONDS_PER_MINUTE % MINUTES_PER_HOUR;
+        const unsigned seconds = epoch % SECONDS_PER_MINUTE;
+
+        snprintf(body, sizeof(body), "GNGGA,%02u%02u%02u.00,4025.6800,N,08651.7800,W,1,14,0.8,187.0,M,-33.9,M,,",
+                 hours, minutes, seconds);
+        AppendNmea(capture, body);
+        snprintf(body, sizeof(body), "GNRMC,%02u%02u%02u.00,A,4025.6800,N,08651.7800,W,0.486,90.00,191026,,,A", hours,
+                 minutes, seconds);
+        AppendNmea(capture, body);
+        AppendNavPvt(capture, epoch);
+    }
+    return capture;
+}
+
+static std::vector<uint8_t> Load(const char *path)
+{
+    std::vector<uint8_t> capture;
+    FILE *file = fopen(path, "rbe");
+    if (file == NULL)
+    {
+        return capture;
+    }
+
+    uint8_t block[4096];
+    size_t read = 0;
+    while ((read = fread(block, 1, sizeof(block), file)) > 0)
+    {
+        capture.insert(capture.end(), block, block + read);
+    }
+    fclose(file);
+    return capture;
+}
+
+/* Feed `capture` in random DMA-sized chunks */
+static void Feed(gnss::Parser &parser, std::span<const uint8_t> capture, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<size_t> chunk(1, MAX_CHUNK);
+    size_t offset = 0;
+    while (offset < capture.size())
+    {
+        const size_t length = std::min(chunk(rng), capture.size() - offset);
+        parser.Consume(capture.subspan(offset, length));
+        offset += length;
+    }
+}
+
+/* Returns false if the synthetic stream decoded to anything but what it encodes */
+static bool Bench(std::span<const uint8_t> capture, bool synthetic)
+{
+    std::mt19937 rng(1);
+    CountingListener listener;
+    gnss::Parser parser(listener);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        Feed(parser, capture, rng);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const double bytes = static_cast<double>(capture.size()) * BENCH_PASSES;
+    const gnss::Stats &stats = parser.GetStats();
+
+    printf("throughput: %.1f MB/s (%.0f bytes in %.3f s)\n", bytes / seconds / BYTES_PER_MB, bytes, seconds);
+    printf("frames: %u NMEA, %u UBX, %u checksum errors, %u framing errors, %u discarded bytes\n",
+           stats.nmea_frames / BENCH_PASSES, stats.ubx_frames / BENCH_PASSES, stats.checksum_errors,
+           stats.framing_errors, stats.discarded_bytes);
+    if (!synthetic)
+    {
+        return true;
+    }
+
+    bool ok = Expect(listener.positions == static_cast<uint64_t>(POSITIONS_PER_EPOCH) * SYNTHETIC_EPOCHS * BENCH_PASSES,
+                     "positions lost");
+    ok &= Expect(listener.times == static_cast<uint64_t>(TIMES_PER_EPOCH) * SYNTHETIC_EPOCHS * BENCH_PASSES,
+                 "times lost");
+    ok &= Expect(listener.mismatches == 0, "decoded values differ from the synthetic stream");
+    return ok;
+}
+
+/* Returns false if corruption ever stopped the parser from recovering */
+static bool Fuzz(std::span<const uint8_t> capture)
+{
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<uint32_t> byte(0, UINT8_MAX);
+    std::uniform_int_distribution<size_t> position(0, capture.size() - 1);
+    std::uniform_int_distribution<int> edits(1, FUZZ_MAX_EDITS);
+
+    CountingListener clean_listener;
+    gnss::Parser clean(clean_listener);
+    Feed(clean, capture, rng);
+    const uint64_t clean_frames = clean_listener.positions;
+
+    for (int round = 0; round < FUZZ_ROUNDS; round++)
+    {
+        std::vector<uint8_t> mutated(GARBAGE_BURST);
+        for (uint8_t &garbage : mutated)
+        {
+            garbage = static_cast<uint8_t>(byte(rng));
+        }
+        mutated.insert(mutated.end(), capture.begin(), capture.end());
+
+        const int count = edits(rng);
+        for (int i = 0; i < count; i++)
+        {
+            mutated[GARBAGE_BURST + position(rng)] = static_cast<uint8_t>(byte(rng));
+        }
+
+        CountingListener listener;
+        gnss::Parser parser(listener);
+        Feed(parser, mutated, rng);
+
+        /* Leading garbage may eat the first frame, each edit a few more */
+        if (listener.positions + 2 + static_cast<uint64_t>(count) * FUZZ_LOSS_PER_EDIT < clean_frames)
+        {
+            printf("fuzz round %d: %llu of %llu positions after %d edits\n", round,
+                   static_cast<unsigned long long>(listener.positions), static_cast<unsigned long long>(clean_frames),
+                   count);
+            return false;
+        }
+    }
+
+    printf("fuzz: %d rounds ok, %llu positions per clean pass\n", FUZZ_ROUNDS,
+           static_cast<unsigned long long>(clean_frames));
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const std::vector<uint8_t> capture = argc > 1 ? Load(argv[1]) : Synthesize();
+    if (capture.empty())
+    {
+        printf("empty capture\n");
+        return 1;
+    }
+    printf("capture: %zu bytes\n", capture.size());
+
+    bool ok = Bench(capture, argc <= 1);
+    ok &= Fuzz(capture);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdio.h>
+
+/*
+ * Checks shared by the Native harnesses, which `ctest` runs: each one ANDs
+ * the results together and exits non-zero if any check failed.
+ */
+
+/* Returns `condition`, printing `what` went wrong when it is false */
+inline bool Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", what);
+    }
+    return condition;
+}
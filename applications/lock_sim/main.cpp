@@ -0,0 +1,273 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "boot.h"
+#include "expect.h"
+#include "lock_profiler.h"
+#include "task_stack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iterator>
+
+/*
+ * Native simulation of lock contention and priority inversion.
+ *
+ * A high priority IMU task shares an I2C bus with a low priority barometer and
+ * logs every sample, while a low priority logger holds the log mutex for long
+ * writes and a mid priority telemetry task burns CPU without any lock. When
+ * the IMU blocks on the log or bus mutex, the holder must inherit its
+ * priority, or telemetry would keep it (and so the IMU) off the CPU. After
+ * RUN_MS the profile is serialized, decoded and printed, and checked for the
+ * expected contention and inheritance.
+ *
+ * A scripted chain then checks that an inheritance episode lasts from the
+ * first raise to the return to the base priority: a holder is raised by a
+ * mid and then a high priority waiter, and stays raised after the high one
+ * times out until it gives the mutex back.
+ */
+
+#define RUN_MS 500
+
+/* Busy time per operation, in microseconds */
+#define LOG_WRITE_US 800
+#define IMU_READ_US 50
+#define IMU_LOG_US 10
+#define BARO_READ_US 300
+#define TELEMETRY_US 1500
+
+/* Pause between operations, in milliseconds */
+#define LOG_PERIOD_MS 2
+#define BARO_PERIOD_MS 5
+#define TELEMETRY_PERIOD_MS 3
+#define IMU_PERIOD_MS 1
+#define NS_PER_US 1000
+#define NS_PER_MS 1000000
+
+/* The high waiter's timeout, then how much longer the holder keeps the mutex */
+#define CHAIN_TIMEOUT_MS 5
+#define CHAIN_HOLD_MS 10
+
+#define TASK_STACK_SIZE 256
+#define REPORT_STACK_SIZE 1024
+
+#define LOW_PRIORITY 1
+#define TELEMETRY_PRIORITY 2
+#define IMU_PRIORITY 3
+#define REPORT_PRIORITY 4
+
+void LoggerTask(void *argument);
+void BaroTask(void *argument);
+void TelemetryTask(void *argument);
+void ImuTask(void *argument);
+void ReportTask(void *argument);
+void ChainHolderTask(void *argument);
+void ChainWaiterTask(void *argument);
+
+TASK_STACK(LoggerTask, TASK_STACK_SIZE);
+TASK_STACK(BaroTask, TASK_STACK_SIZE);
+TASK_STACK(TelemetryTask, TASK_STACK_SIZE);
+TASK_STACK(ImuTask, TASK_STACK_SIZE);
+TASK_STACK(ReportTask, REPORT_STACK_SIZE);
+TASK_STACK(ChainHolderTask, TASK_STACK_SIZE);
+static StaticTask_t logger_tcb;
+static StaticTask_t baro_tcb;
+static StaticTask_t telemetry_tcb;
+static StaticTask_t imu_tcb;
+static StaticTask_t report_tcb;
+static StaticTask_t chain_holder_tcb;
+
+/* The mid and high priority chain waiters */
+static StackType_t chain_waiter_stacks[2][TASK_STACK_SIZE];
+static StaticTask_t chain_waiter_tcbs[2];
+
+static TaskHandle_t logger_task;
+static TaskHandle_t baro_task;
+static TaskHandle_t telemetry_task;
+static TaskHandle_t imu_task;
+
+static lock_profiler::Mutex log_mutex("log");
+static lock_profiler::Mutex i2c_mutex("i2c1");
+static lock_profiler::Mutex params_mutex("params", lock_profiler::Mutex::Kind::Recursive);
+static lock_profiler::Mutex chain_mutex("chain");
+
+static uint8_t table[lock_profiler::kMaxTableSize];
+
+/* Stands in for a peripheral transfer, the simulated CPU stays busy */
+static void Busy(uint32_t microseconds)
+{
+    const uint32_t start = boot::CycleCount();
+    while (boot::CycleCount() - start < microseconds * NS_PER_US)
+    {
+    }
+}
+
+void LoggerTask(void *argument)
+{
+    (void)argument;
+    for (;;)
+    {
+        {
+            lock_profiler::Lock lock(log_mutex);
+            Busy(LOG_WRITE_US);
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_PERIOD_MS));
+    }
+}
+
+void BaroTask(void *argument)
+{
+    (void)argument;
+    for (;;)
+    {
+        {
+            lock_profiler::Lock lock(i2c_mutex);
+            Busy(BARO_READ_US);
+        }
+        vTaskDelay(pdMS_TO_TICKS(BARO_PERIOD_MS));
+    }
+}
+
+void TelemetryTask(void *argument)
+{
+    (void)argument;
+    for (;;)
+    {
+        Busy(TELEMETRY_US);
+        vTaskDelay(pdMS_TO_TICKS(TELEMETRY_PERIOD_MS));
+    }
+}
+
+void ImuTask(void *argument)
+{
+    (void)argument;
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(IMU_PERIOD_MS));
+        {
+            lock_profiler::Lock lock(i2c_mutex);
+            Busy(IMU_READ_US);
+        }
+        {
+            lock_profiler::Lock lock(log_mutex);
+            Busy(IMU_LOG_US);
+        }
+    }
+}
+
+void ChainHolderTask(void *argument)
+{
+    (void)argument;
+    {
+        lock_profiler::Lock lock(chain_mutex);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    vTaskDelete(NULL);
+}
+
+/* `argument` is how many ticks to wait for the chain mutex */
+void ChainWaiterTask(void *argument)
+{
+    const auto wait = static_cast<TickType_t>(reinterpret_cast<uintptr_t>(argument));
+    {
+        lock_profiler::Lock lock(chain_mutex, wait);
+    }
+    vTaskDelete(NULL);
+}
+
+static bool CheckRecursive()
+{
+    bool ok = true;
+    {
+        lock_profiler::Lock outer(params_mutex);
+        lock_profiler::Lock inner(params_mutex);
+        ok &= Expect(static_cast<bool>(outer) && static_cast<bool>(inner), "recursive take failed");
+    }
+    ok &= Expect(params_mutex.GetStats().acquisitions == 1, "nested take counted as an acquisition");
+    ok &= Expect(params_mutex.GetStats().contended == 0, "own recursive mutex counted as contended");
+    return ok;
+}
+
+static TaskHandle_t StartChainWaiter(int index, UBaseType_t priority, TickType_t wait)
+{
+    return xTaskCreateStatic(ChainWaiterTask, "ChainWaiter", TASK_STACK_SIZE,
+                             reinterpret_cast<void *>(static_cast<uintptr_t>(wait)), priority,
+                             chain_waiter_stacks[index], &chain_waiter_tcbs[index]);
+}
+
+/* Runs with the simulation suspended, so only the chain tasks compete for the CPU */
+static bool CheckChain()
+{
+    const TaskHandle_t holder = xTaskCreateStatic(ChainHolderTask, "ChainHolder", std::size(ChainHolderTask_stack),
+                                                  NULL, LOW_PRIORITY, ChainHolderTask_stack, &chain_holder_tcb);
+    vTaskDelay(pdMS_TO_TICKS(1));
+
+    /* The high waiter raises the holder, the mid one keeps it raised once the high one gives up */
+    StartChainWaiter(0, TELEMETRY_PRIORITY, portMAX_DELAY);
+    StartChainWaiter(1, IMU_PRIORITY, pdMS_TO_TICKS(CHAIN_TIMEOUT_MS));
+    vTaskDelay(pdMS_TO_TICKS(CHAIN_TIMEOUT_MS + CHAIN_HOLD_MS));
+    xTaskNotifyGive(holder);
+    vTaskDelay(pdMS_TO_TICKS(1));
+
+    bool ok = Expect(chain_mutex.GetStats().timeouts == 1, "high chain waiter did not time out");
+#if LOCK_PROFILER
+    const lock_profiler::InheritanceStats chain = lock_profiler::GetInheritance(holder);
+    ok &= Expect(chain.episodes == 1 && chain.highest == IMU_PRIORITY, "chain holder not raised once to the top");
+    ok &= Expect(chain.longest >= static_cast<uint32_t>(CHAIN_HOLD_MS) * NS_PER_MS,
+                 "inheritance ended while the mid waiter was still blocked");
+#endif
+    return ok;
+}
+
+void ReportTask(void *argument)
+{
+    (void)argument;
+    bool ok = CheckRecursive();
+
+    /* Highest priority: once this wakes nothing else runs */
+    vTaskDelay(pdMS_TO_TICKS(RUN_MS));
+    vTaskSuspend(logger_task);
+    vTaskSuspend(baro_task);
+    vTaskSuspend(telemetry_task);
+    vTaskSuspend(imu_task);
+    ok &= CheckChain();
+
+    const size_t length = lock_profiler::Serialize(table);
+    ok &= Expect(length > 0 && lock_profiler::Print({table, length}), "table did not decode");
+    ok &= Expect(length > 0 && !lock_profiler::Print({table, length - 1}), "truncated table decoded");
+    printf("table: %zu bytes\n", length);
+
+    const lock_profiler::LockStats &log = log_mutex.GetStats();
+    const lock_profiler::LockStats &i2c = i2c_mutex.GetStats();
+    ok &= Expect(log.acquisitions > 0 && i2c.acquisitions > 0, "locks never taken");
+    ok &= Expect(log.contended > 0 && log.wait_max > 0, "no contention on the log");
+    ok &= Expect(log.hold_max >= LOG_WRITE_US * NS_PER_US, "log hold shorter than a write");
+#if LOCK_PROFILER
+    const lock_profiler::InheritanceStats logger = lock_profiler::GetInheritance(logger_task);
+    ok &= Expect(log_mutex.GetInheritances() > 0, "logger never inherited the IMU's priority");
+    ok &= Expect(logger.episodes > 0 && logger.highest == IMU_PRIORITY, "logger inheritance not recorded");
+    ok &= Expect(logger.longest > 0 && logger.longest <= logger.total, "logger inheritance durations inconsistent");
+#endif
+
+    printf("%s\n", ok ? "lock profile ok" : "lock profile FAILED");
+    exit(ok ? 0 : 1);
+}
+
+int main(void)
+{
+    logger_task = xTaskCreateStatic(LoggerTask, "Logger", std::size(LoggerTask_stack), NULL, LOW_PRIORITY,
+                                    LoggerTask_stack, &logger_tcb);
+    baro_task =
+        xTaskCreateStatic(BaroTask, "Baro", std::size(BaroTask_stack), NULL, LOW_PRIORITY, BaroTask_stack, &baro_tcb);
+    telemetry_task = xTaskCreateStatic(TelemetryTask, "Telemetry", std::size(TelemetryTask_stack), NULL,
+                                       TELEMETRY_PRIORITY, TelemetryTask_stack, &telemetry_tcb);
+    imu_task = xTaskCreateStatic(ImuTask, "Imu", std::size(ImuTask_stack), NULL, IMU_PRIORITY, ImuTask_stack, &imu_tcb);
+    xTaskCreateStatic(ReportTask, "Report", std::size(ReportTask_stack), NULL, REPORT_PRIORITY, ReportTask_stack,
+                      &report_tcb);
+
+    vTaskStartScheduler();
+    return 1;
+}
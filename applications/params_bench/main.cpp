@@ -0,0 +1,152 @@
+#include "expect.h"
+#include "file_storage.h"
+#include "params.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Native benchmark and persistence check for the parameter store.
+ *
+ * Compares the cost of `params::Get<>()` against a string-keyed map lookup,
+ * then exercises the file backed storage: save and restore, recovery from a
+ * corrupted newest slot and wear rotation once the region is full.
+ */
+
+#define READS 100000000
+#define BENCH_PATH "params_bench.bin"
+#define BENCH_REGION_SIZE 1024
+#define BENCH_WRITE_UNIT 32
+#define ERASED_BYTE 0xFF
+
+/* Defaults from param_list.h, and the values the check saves over them */
+#define CHAMBER_LIMIT_DEFAULT_PSI 500.0F
+#define CHAMBER_LIMIT_SAVED_PSI 420.0F
+#define VALVE_DELAY_DEFAULT_MS 50
+#define VALVE_DELAY_SAVED_MS 75
+#define VALVE_DELAY_STAGED_MS 90
+
+using params::Id;
+
+static volatile float sink;
+
+template <typename Read>
+static double NanosecondsPerRead(Read read)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < READS; i++)
+    {
+        sink = read();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / READS;
+}
+
+static void BenchReads()
+{
+    std::unordered_map<std::string, float> map;
+    map["kChamberPressureLimitPsi"] = params::Get<Id::kChamberPressureLimitPsi>();
+    map["kTankPressureLimitPsi"] = params::Get<Id::kTankPressureLimitPsi>();
+    const std::string key = "kChamberPressureLimitPsi";
+
+    const double registry = NanosecondsPerRead([] { return params::Get<Id::kChamberPressureLimitPsi>(); });
+    const double string_map = NanosecondsPerRead([&] { return map.find(key)->second; });
+
+    printf("read: registry %.2f ns, string map %.2f ns\n", registry, string_map);
+}
+
+static bool CheckPersistence()
+{
+    remove(BENCH_PATH);
+    params::FileStorage storage(BENCH_PATH, BENCH_REGION_SIZE, BENCH_WRITE_UNIT);
+    bool ok = true;
+
+    params::Store store(storage);
+    ok &= Expect(!store.Load(), "loaded from an erased region");
+    ok &= Expect(params::Get<Id::kChamberPressureLimitPsi>() == CHAMBER_LIMIT_DEFAULT_PSI, "default not applied");
+
+    store.Stage();
+    store.Set<Id::kChamberPressureLimitPsi>(CHAMBER_LIMIT_SAVED_PSI);
+    ok &= Expect(params::Get<Id::kChamberPressureLimitPsi>() == CHAMBER_LIMIT_DEFAULT_PSI,
+                 "staged value visible before commit");
+    ok &= Expect(store.Commit(), "commit failed");
+    ok &= Expect(params::Get<Id::kChamberPressureLimitPsi>() == CHAMBER_LIMIT_SAVED_PSI, "committed value not visible");
+
+    store.Stage();
+    store.Set<Id::kMainValveOpenDelayMs>(VALVE_DELAY_SAVED_MS);
+    ok &= Expect(store.Commit(), "second commit failed");
+
+    /* Same as a reboot: only what is in storage survives */
+    params::Store reloaded(storage);
+    ok &= Expect(reloaded.Load() && reloaded.GetSequence() == 2, "newest slot not restored");
+    ok &= Expect(params::Get<Id::kMainValveOpenDelayMs>() == VALVE_DELAY_SAVED_MS, "restored value wrong");
+
+    /* Clear the last write unit of the newest slot, as an interrupted save would */
+    uint8_t region[BENCH_REGION_SIZE];
+    storage.Read(0, region);
+    size_t end = sizeof(region);
+    while (end > 0 && region[end - 1] == ERASED_BYTE)
+    {
+        end--;
+    }
+    const uint8_t corrupt[BENCH_WRITE_UNIT] = {0};
+    storage.Program((end - 1) / BENCH_WRITE_UNIT * BENCH_WRITE_UNIT, corrupt);
+    params::Store recovered(storage);
+    ok &= Expect(recovered.Load() && recovered.GetSequence() == 1, "did not fall back to the previous slot");
+    ok &= Expect(params::Get<Id::kChamberPressureLimitPsi>() == CHAMBER_LIMIT_SAVED_PSI, "fallback value wrong");
+    ok &= Expect(params::Get<Id::kMainValveOpenDelayMs>() == VALVE_DELAY_DEFAULT_MS,
+                 "fallback kept corrupt slot's value");
+
+    /* A store created after another has committed must stage into the other bank */
+    recovered.Stage();
+    recovered.Set<Id::kMainValveOpenDelayMs>(VALVE_DELAY_STAGED_MS);
+    ok &= Expect(params::Get<Id::kMainValveOpenDelayMs>() == VALVE_DELAY_DEFAULT_MS,
+                 "staged value visible before commit after reload");
+
+    /* Two live stores on one region, and one that never loaded: each save must append after the others */
+    params::Store first(storage);
+    params::Store second(storage);
+    params::Store unloaded(storage);
+    ok &= Expect(first.Load() && second.Load(), "shared region did not load");
+    const uint32_t shared_sequence = first.GetSequence();
+    first.Stage();
+    first.Set<Id::kMainValveOpenDelayMs>(VALVE_DELAY_SAVED_MS);
+    ok &= Expect(first.Commit(), "first shared commit failed");
+    second.Stage();
+    ok &= Expect(params::Get<Id::kMainValveOpenDelayMs>() == VALVE_DELAY_SAVED_MS, "second store staged a stale bank");
+    second.Set<Id::kChamberPressureLimitPsi>(CHAMBER_LIMIT_DEFAULT_PSI);
+    ok &= Expect(second.Commit(), "second shared commit failed");
+    unloaded.Stage();
+    unloaded.Set<Id::kMainValveOpenDelayMs>(VALVE_DELAY_STAGED_MS);
+    ok &= Expect(unloaded.Commit(), "commit without load failed");
+    params::Store shared(storage);
+    ok &= Expect(shared.Load() && shared.GetSequence() == shared_sequence + 3, "shared stores overwrote a slot");
+    ok &= Expect(params::Get<Id::kChamberPressureLimitPsi>() == CHAMBER_LIMIT_DEFAULT_PSI &&
+                     params::Get<Id::kMainValveOpenDelayMs>() == VALVE_DELAY_STAGED_MS,
+                 "shared stores restored the wrong values");
+
+    /* Keep saving past the end of the region, it must erase and carry on */
+    for (uint32_t i = 0; i < 3 * BENCH_REGION_SIZE / BENCH_WRITE_UNIT; i++)
+    {
+        recovered.Stage();
+        recovered.Set<Id::kIgniterFireDurationMs>(i);
+        ok &= Expect(recovered.Commit(), "commit failed while rotating");
+    }
+    params::Store rotated(storage);
+    ok &= Expect(rotated.Load() && rotated.GetSequence() == recovered.GetSequence(), "rotation lost the newest slot");
+
+    remove(BENCH_PATH);
+    return ok;
+}
+
+int main(void)
+{
+    BenchReads();
+
+    const bool ok = CheckPersistence();
+    printf("%s\n", ok ? "persistence ok" : "persistence FAILED");
+    return ok ? 0 : 1;
+}
@@ -3,3 +3,4 @@
 rm -rf build/
 cmake -B build -G Ninja -DTARGET=Native -DCMAKE_BUILD_TYPE=Release
 cmake --build build
+ctest --test-dir build --output-on-failure
@@ -0,0 +1,71 @@
+#include "eth.h"
+
+#include "instances.h"
+
+namespace
+{
+using Eths = async::Instances<async::Eth, ETH_HandleTypeDef, 1>;
+} // namespace
+
+namespace async
+{
+
+Eth::Eth(ETH_HandleTypeDef &handle, coro::Executor &executor, TickType_t timeout)
+    : handle_(handle), tx_(executor, timeout, Abort, this), rx_(executor)
+{
+    Eths::Add(*this);
+}
+
+/* The DMA has no per-packet abort, restarting it releases the stuck descriptors */
+void Eth::Abort(void *context)
+{
+    ETH_HandleTypeDef &handle = static_cast<Eth *>(context)->handle_;
+    HAL_ETH_Stop_IT(&handle);
+    HAL_ETH_Start_IT(&handle);
+}
+
+void Eth::OnTransmitComplete()
+{
+    HAL_ETH_ReleaseTxPacket(&handle_);
+    tx_.CompleteFromIsr(coro::Status::Ok);
+}
+
+void Eth::OnReceiveComplete()
+{
+    rx_.SetFromIsr();
+}
+
+void Eth::OnError()
+{
+    /* A DMA bus error stops the transmit engine, the pending transmit would never complete */
+    if ((HAL_ETH_GetDMAError(&handle_) & ETH_DMACSR_FBE) != 0U)
+    {
+        tx_.CompleteFromIsr(coro::Status::Error);
+    }
+}
+
+} // namespace async
+
+extern "C" void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth)
+{
+    if (async::Eth *eth = Eths::Find(heth))
+    {
+        eth->OnTransmitComplete();
+    }
+}
+
+extern "C" void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth)
+{
+    if (async::Eth *eth = Eths::Find(heth))
+    {
+        eth->OnReceiveComplete();
+    }
+}
+
+extern "C" void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *heth)
+{
+    if (async::Eth *eth = Eths::Find(heth))
+    {
+        eth->OnError();
+    }
+}
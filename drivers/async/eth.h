@@ -0,0 +1,66 @@
+#pragma once
+
+#include "coro.h"
+#include "stm32h7xx_hal.h"
+
+namespace async
+{
+
+/*
+ * Interrupt driven Ethernet for coroutines, on top of the descriptor based
+ * (non-legacy) H7 ETH HAL.
+ *
+ * ```cpp
+ * for (;;)
+ * {
+ *     co_await eth.FrameReceived();
+ *     while (HAL_ETH_ReadData(&heth, &buffer) == HAL_OK) { ... }
+ * }
+ * ```
+ *
+ * Reception is signalled rather than completed because frames arrive whether
+ * or not a coroutine is waiting: a frame received while the receiver is busy
+ * is latched and the next `FrameReceived()` returns at once. Transmitted
+ * descriptors are released from the transmit complete interrupt. Transmits
+ * queue in the order they were awaited; one still pending after `timeout`
+ * ticks restarts the MAC and DMA and completes with `Status::Timeout`.
+ */
+class Eth
+{
+public:
+    Eth(ETH_HandleTypeDef &handle, coro::Executor &executor,
+        TickType_t timeout = pdMS_TO_TICKS(CORO_TRANSFER_TIMEOUT_MS));
+
+    Eth(const Eth &) = delete;
+    Eth &operator=(const Eth &) = delete;
+
+    /* `config` and the buffers it points to must stay valid until the transmit completes */
+    auto Transmit(ETH_TxPacketConfigTypeDef &config)
+    {
+        return tx_.Wait([this, &config] { return HAL_ETH_Transmit_IT(&handle_, &config) == HAL_OK; });
+    }
+
+    coro::Event &FrameReceived()
+    {
+        return rx_;
+    }
+
+    ETH_HandleTypeDef &GetHandle()
+    {
+        return handle_;
+    }
+
+    /* From the HAL's interrupt callbacks */
+    void OnTransmitComplete();
+    void OnReceiveComplete();
+    void OnError();
+
+private:
+    static void Abort(void *context);
+
+    ETH_HandleTypeDef &handle_;
+    coro::Completion tx_;
+    coro::Event rx_;
+};
+
+} // namespace async
@@ -0,0 +1,72 @@
+#include "i2c.h"
+
+#include "instances.h"
+
+namespace
+{
+
+using I2cs = async::Instances<async::I2c, I2C_HandleTypeDef>;
+
+void Complete(I2C_HandleTypeDef *hi2c, coro::Status status)
+{
+    if (async::I2c *i2c = I2cs::Find(hi2c))
+    {
+        i2c->OnComplete(status);
+    }
+}
+
+} // namespace
+
+namespace async
+{
+
+I2c::I2c(I2C_HandleTypeDef &handle, coro::Executor &executor, TickType_t timeout)
+    : handle_(handle), done_(executor, timeout, Abort, this)
+{
+    I2cs::Add(*this);
+}
+
+/* The HAL's only I2C abort is interrupt driven and needs the device address, starting over is simpler */
+void I2c::Abort(void *context)
+{
+    I2C_HandleTypeDef &handle = static_cast<I2c *>(context)->handle_;
+    HAL_I2C_DeInit(&handle);
+    HAL_I2C_Init(&handle);
+}
+
+void I2c::OnComplete(coro::Status status)
+{
+    done_.CompleteFromIsr(status);
+}
+
+} // namespace async
+
+extern "C" void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Complete(hi2c, coro::Status::Ok);
+}
+
+extern "C" void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Complete(hi2c, coro::Status::Ok);
+}
+
+extern "C" void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Complete(hi2c, coro::Status::Ok);
+}
+
+extern "C" void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Complete(hi2c, coro::Status::Ok);
+}
+
+extern "C" void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    Complete(hi2c, coro::Status::Error);
+}
+
+extern "C" void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Complete(hi2c, coro::Status::Error);
+}
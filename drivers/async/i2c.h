@@ -0,0 +1,91 @@
+#pragma once
+
+#include "coro.h"
+#include "stm32h7xx_hal.h"
+
+#include <stdint.h>
+
+#include <span>
+
+namespace async
+{
+
+/*
+ * Interrupt driven I2C master transfers for coroutines.
+ *
+ * `address` is the 7-bit device address. The bus carries one transfer at a
+ * time: transfers from sequences sharing it queue and run in the order they
+ * were awaited. A NACK or arbitration loss completes with `Status::Error`. A
+ * transfer still running after `timeout` ticks (a device holding the bus, a
+ * lost interrupt) reinitialises the peripheral and completes with
+ * `Status::Timeout`. Buffers must stay valid until the transfer completes.
+ */
+class I2c
+{
+public:
+    I2c(I2C_HandleTypeDef &handle, coro::Executor &executor,
+        TickType_t timeout = pdMS_TO_TICKS(CORO_TRANSFER_TIMEOUT_MS));
+
+    I2c(const I2c &) = delete;
+    I2c &operator=(const I2c &) = delete;
+
+    auto Write(uint8_t address, std::span<const uint8_t> data)
+    {
+        return done_.Wait([this, address, data] {
+            return data.size() <= UINT16_MAX &&
+                   HAL_I2C_Master_Transmit_IT(&handle_, DeviceAddress(address), const_cast<uint8_t *>(data.data()),
+                                              static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    auto Read(uint8_t address, std::span<uint8_t> data)
+    {
+        return done_.Wait([this, address, data] {
+            return data.size() <= UINT16_MAX &&
+                   HAL_I2C_Master_Receive_IT(&handle_, DeviceAddress(address), data.data(),
+                                             static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    /* Writes `data` to the device's 8-bit register `reg` onwards */
+    auto WriteRegister(uint8_t address, uint8_t reg, std::span<const uint8_t> data)
+    {
+        return done_.Wait([this, address, reg, data] {
+            return data.size() <= UINT16_MAX &&
+                   HAL_I2C_Mem_Write_IT(&handle_, DeviceAddress(address), reg, I2C_MEMADD_SIZE_8BIT,
+                                        const_cast<uint8_t *>(data.data()),
+                                        static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    /* Reads the device's 8-bit register `reg` onwards into `data` */
+    auto ReadRegister(uint8_t address, uint8_t reg, std::span<uint8_t> data)
+    {
+        return done_.Wait([this, address, reg, data] {
+            return data.size() <= UINT16_MAX &&
+                   HAL_I2C_Mem_Read_IT(&handle_, DeviceAddress(address), reg, I2C_MEMADD_SIZE_8BIT, data.data(),
+                                       static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    I2C_HandleTypeDef &GetHandle()
+    {
+        return handle_;
+    }
+
+    /* From the HAL's interrupt callbacks */
+    void OnComplete(coro::Status status);
+
+private:
+    static void Abort(void *context);
+
+    static uint16_t DeviceAddress(uint8_t address)
+    {
+        return static_cast<uint16_t>(address << 1);
+    }
+
+    I2C_HandleTypeDef &handle_;
+    coro::Completion done_;
+};
+
+} // namespace async
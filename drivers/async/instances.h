@@ -0,0 +1,50 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <stddef.h>
+
+namespace async
+{
+
+/*
+ * Maps a HAL handle back to the driver object wrapping it.
+ *
+ * Callback registration is disabled in `stm32h7xx_hal_conf.h`, so completion
+ * interrupts arrive through the HAL's global weak callbacks, which only get
+ * the handle. Drivers are long lived and few, a linear search is enough.
+ */
+template <typename Driver, typename Handle, size_t N = 4>
+class Instances
+{
+public:
+    static void Add(Driver &driver)
+    {
+        for (Driver *&slot : drivers_)
+        {
+            if (slot == nullptr)
+            {
+                slot = &driver;
+                return;
+            }
+        }
+        configASSERT(0);
+    }
+
+    static Driver *Find(const Handle *handle)
+    {
+        for (Driver *driver : drivers_)
+        {
+            if (driver != nullptr && &driver->GetHandle() == handle)
+            {
+                return driver;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    static inline Driver *drivers_[N] = {};
+};
+
+} // namespace async
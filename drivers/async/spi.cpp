@@ -0,0 +1,59 @@
+#include "spi.h"
+
+#include "instances.h"
+
+namespace
+{
+
+using Spis = async::Instances<async::Spi, SPI_HandleTypeDef>;
+
+void Complete(SPI_HandleTypeDef *hspi, coro::Status status)
+{
+    if (async::Spi *spi = Spis::Find(hspi))
+    {
+        spi->OnComplete(status);
+    }
+}
+
+} // namespace
+
+namespace async
+{
+
+Spi::Spi(SPI_HandleTypeDef &handle, coro::Executor &executor, TickType_t timeout)
+    : handle_(handle), done_(executor, timeout, Abort, this)
+{
+    Spis::Add(*this);
+}
+
+void Spi::Abort(void *context)
+{
+    HAL_SPI_Abort(&static_cast<Spi *>(context)->handle_);
+}
+
+void Spi::OnComplete(coro::Status status)
+{
+    done_.CompleteFromIsr(status);
+}
+
+} // namespace async
+
+extern "C" void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    Complete(hspi, coro::Status::Ok);
+}
+
+extern "C" void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    Complete(hspi, coro::Status::Ok);
+}
+
+extern "C" void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    Complete(hspi, coro::Status::Ok);
+}
+
+extern "C" void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    Complete(hspi, coro::Status::Error);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "coro.h"
+#include "stm32h7xx_hal.h"
+
+#include <stdint.h>
+
+#include <span>
+
+namespace async
+{
+
+/*
+ * Interrupt driven SPI master transfers for coroutines.
+ *
+ * Chip select is left to the caller, so one `Spi` can serve every device on
+ * the bus. Transfers run one at a time in the order they were awaited, and
+ * one still running after `timeout` ticks is aborted and completes with
+ * `Status::Timeout`. Buffers must stay valid until the transfer completes.
+ */
+class Spi
+{
+public:
+    Spi(SPI_HandleTypeDef &handle, coro::Executor &executor,
+        TickType_t timeout = pdMS_TO_TICKS(CORO_TRANSFER_TIMEOUT_MS));
+
+    Spi(const Spi &) = delete;
+    Spi &operator=(const Spi &) = delete;
+
+    auto Transmit(std::span<const uint8_t> data)
+    {
+        return done_.Wait([this, data] {
+            return data.size() <= UINT16_MAX && HAL_SPI_Transmit_IT(&handle_, const_cast<uint8_t *>(data.data()),
+                                                                    static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    auto Receive(std::span<uint8_t> data)
+    {
+        return done_.Wait([this, data] {
+            return data.size() <= UINT16_MAX &&
+                   HAL_SPI_Receive_IT(&handle_, data.data(), static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    /* Full duplex, `tx` and `rx` must be the same size */
+    auto Transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx)
+    {
+        return done_.Wait([this, tx, rx] {
+            return tx.size() == rx.size() && tx.size() <= UINT16_MAX &&
+                   HAL_SPI_TransmitReceive_IT(&handle_, const_cast<uint8_t *>(tx.data()), rx.data(),
+                                              static_cast<uint16_t>(tx.size())) == HAL_OK;
+        });
+    }
+
+    SPI_HandleTypeDef &GetHandle()
+    {
+        return handle_;
+    }
+
+    /* From the HAL's interrupt callbacks */
+    void OnComplete(coro::Status status);
+
+private:
+    static void Abort(void *context);
+
+    SPI_HandleTypeDef &handle_;
+    coro::Completion done_;
+};
+
+} // namespace async
@@ -0,0 +1,71 @@
+#include "uart.h"
+
+#include "instances.h"
+
+namespace
+{
+using Uarts = async::Instances<async::Uart, UART_HandleTypeDef>;
+} // namespace
+
+namespace async
+{
+
+Uart::Uart(UART_HandleTypeDef &handle, coro::Executor &executor, TickType_t timeout)
+    : handle_(handle), tx_(executor, timeout, AbortTransmit, this), rx_(executor)
+{
+    Uarts::Add(*this);
+}
+
+void Uart::AbortTransmit(void *context)
+{
+    HAL_UART_AbortTransmit(&static_cast<Uart *>(context)->handle_);
+}
+
+void Uart::OnTransmitComplete()
+{
+    tx_.CompleteFromIsr(coro::Status::Ok);
+}
+
+void Uart::OnReceiveComplete()
+{
+    rx_.CompleteFromIsr(coro::Status::Ok);
+}
+
+void Uart::OnError()
+{
+    /* Only errors that stop the transfer (e.g. overrun) return the HAL to ready, the rest are reported and continue */
+    if (handle_.RxState == HAL_UART_STATE_READY)
+    {
+        rx_.CompleteFromIsr(coro::Status::Error);
+    }
+    if (handle_.gState == HAL_UART_STATE_READY)
+    {
+        tx_.CompleteFromIsr(coro::Status::Error);
+    }
+}
+
+} // namespace async
+
+extern "C" void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (async::Uart *uart = Uarts::Find(huart))
+    {
+        uart->OnTransmitComplete();
+    }
+}
+
+extern "C" void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (async::Uart *uart = Uarts::Find(huart))
+    {
+        uart->OnReceiveComplete();
+    }
+}
+
+extern "C" void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (async::Uart *uart = Uarts::Find(huart))
+    {
+        uart->OnError();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "coro.h"
+#include "stm32h7xx_hal.h"
+
+#include <stdint.h>
+
+#include <span>
+
+namespace async
+{
+
+/*
+ * Interrupt driven UART transfers for coroutines.
+ *
+ * ```cpp
+ * coro::Status status = co_await uart.Transmit(frame);
+ * ```
+ *
+ * One transmit and one receive are in flight at a time, others queue in the
+ * order they were awaited. A transmit still running after `timeout` ticks is
+ * aborted and completes with `Status::Timeout`; a receive waits for its data
+ * however long it takes. Buffers must stay valid until the transfer
+ * completes, so keep them in the coroutine frame or in static storage. The UART's IRQ priority must be numerically at
+ * least configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY.
+ */
+class Uart
+{
+public:
+    Uart(UART_HandleTypeDef &handle, coro::Executor &executor,
+         TickType_t timeout = pdMS_TO_TICKS(CORO_TRANSFER_TIMEOUT_MS));
+
+    Uart(const Uart &) = delete;
+    Uart &operator=(const Uart &) = delete;
+
+    auto Transmit(std::span<const uint8_t> data)
+    {
+        return tx_.Wait([this, data] {
+            return data.size() <= UINT16_MAX && HAL_UART_Transmit_IT(&handle_, const_cast<uint8_t *>(data.data()),
+                                                                     static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    auto Receive(std::span<uint8_t> data)
+    {
+        return rx_.Wait([this, data] {
+            return data.size() <= UINT16_MAX &&
+                   HAL_UART_Receive_IT(&handle_, data.data(), static_cast<uint16_t>(data.size())) == HAL_OK;
+        });
+    }
+
+    UART_HandleTypeDef &GetHandle()
+    {
+        return handle_;
+    }
+
+    /* From the HAL's interrupt callbacks */
+    void OnTransmitComplete();
+    void OnReceiveComplete();
+    void OnError();
+
+private:
+    static void AbortTransmit(void *context);
+
+    UART_HandleTypeDef &handle_;
+    coro::Completion tx_;
+    coro::Completion rx_;
+};
+
+} // namespace async
@@ -0,0 +1,634 @@
+#include "gnss.h"
+
+namespace gnss
+{
+
+namespace
+{
+
+constexpr uint8_t kNmeaStart = '$';
+constexpr uint8_t kNmeaChecksumMarker = '*';
+constexpr uint8_t kNmeaFieldSeparator = ',';
+constexpr uint8_t kNmeaMaxLength = 96; /* 82 per the spec, some receivers run long */
+constexpr uint8_t kNmeaMaxDecimals = 9;
+constexpr uint32_t kNmeaSentenceMask = 0xFFFFFF;
+constexpr uint32_t kNmeaGga = ('G' << 16) | ('G' << 8) | 'A';
+constexpr uint32_t kNmeaRmc = ('R' << 16) | ('M' << 8) | 'C';
+
+constexpr uint8_t kUbxSync1 = 0xB5;
+constexpr uint8_t kUbxSync2 = 0x62;
+constexpr uint16_t kUbxMaxPayload = 1024;
+constexpr uint8_t kUbxClassNav = 0x01;
+constexpr uint8_t kUbxIdNavPvt = 0x07;
+constexpr uint16_t kUbxNavPvtLength = 92;
+
+constexpr uint64_t kDegreesE7 = 10000000;
+constexpr uint64_t kNanoseconds = 1000000000;
+constexpr uint64_t kMinutesPerDegree = 60;
+constexpr uint64_t kHundred = 100;
+constexpr uint64_t kTenThousand = 10000;
+constexpr uint16_t kCenturyBase = 2000;
+constexpr uint64_t kMetersPerNauticalMile = 1852;
+constexpr uint64_t kSecondsPerHour = 3600;
+
+constexpr uint64_t kPow10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+bool IsDigit(uint8_t byte)
+{
+    return byte >= '0' && byte <= '9';
+}
+
+bool IsPrintable(uint8_t byte)
+{
+    return byte >= ' ' && byte <= '~';
+}
+
+/* Returns -1 for anything that is not an uppercase hex digit */
+int HexValue(uint8_t byte)
+{
+    if (IsDigit(byte))
+    {
+        return byte - '0';
+    }
+    if (byte >= 'A' && byte <= 'F')
+    {
+        return byte - 'A' + 10;
+    }
+    return -1;
+}
+
+} // namespace
+
+Parser::Parser(Listener &listener) : listener_(listener)
+{
+}
+
+void Parser::Consume(std::span<const uint8_t> bytes)
+{
+    for (const uint8_t byte : bytes)
+    {
+        Step(byte);
+    }
+}
+
+void Parser::Consume(std::span<const uint8_t> first, std::span<const uint8_t> second)
+{
+    Consume(first);
+    Consume(second);
+}
+
+void Parser::Reset()
+{
+    state_ = State::Hunt;
+}
+
+void Parser::Step(uint8_t byte)
+{
+    switch (state_)
+    {
+    case State::Hunt:
+        Hunt(byte);
+        break;
+
+    case State::NmeaAddress:
+        StepNmeaAddress(byte);
+        break;
+
+    case State::NmeaField:
+        StepNmeaField(byte);
+        break;
+
+    case State::NmeaChecksumHigh: {
+        const int value = HexValue(byte);
+        if (value < 0)
+        {
+            Fail(byte);
+            break;
+        }
+        nmea_expected_ = static_cast<uint8_t>(value << 4);
+        state_ = State::NmeaChecksumLow;
+        break;
+    }
+
+    case State::NmeaChecksumLow: {
+        const int value = HexValue(byte);
+        if (value < 0)
+        {
+            Fail(byte);
+            break;
+        }
+        nmea_expected_ |= static_cast<uint8_t>(value);
+        state_ = State::Hunt;
+        FinishNmea();
+        break;
+    }
+
+    case State::UbxSync:
+        if (byte != kUbxSync2)
+        {
+            Fail(byte);
+            break;
+        }
+        ubx_ck_a_ = 0;
+        ubx_ck_b_ = 0;
+        state_ = State::UbxClass;
+        break;
+
+    case State::UbxClass:
+        UbxChecksum(byte);
+        ubx_class_ = byte;
+        state_ = State::UbxId;
+        break;
+
+    case State::UbxId:
+        UbxChecksum(byte);
+        ubx_id_ = byte;
+        state_ = State::UbxLengthLow;
+        break;
+
+    case State::UbxLengthLow:
+        UbxChecksum(byte);
+        ubx_length_ = byte;
+        state_ = State::UbxLengthHigh;
+        break;
+
+    case State::UbxLengthHigh:
+        UbxChecksum(byte);
+        ubx_length_ |= static_cast<uint16_t>(byte << 8);
+        if (ubx_length_ > kUbxMaxPayload)
+        {
+            Fail(byte);
+            break;
+        }
+        ubx_index_ = 0;
+        ubx_word_ = 0;
+        time_ = {};
+        position_ = {};
+        velocity_ = {};
+        state_ = ubx_length_ == 0 ? State::UbxChecksumA : State::UbxPayload;
+        break;
+
+    case State::UbxPayload:
+        UbxChecksum(byte);
+        StepUbxPayload(byte);
+        if (++ubx_index_ == ubx_length_)
+        {
+            state_ = State::UbxChecksumA;
+        }
+        break;
+
+    case State::UbxChecksumA:
+        if (byte != ubx_ck_a_)
+        {
+            stats_.checksum_errors++;
+            state_ = State::Hunt;
+            Hunt(byte);
+            break;
+        }
+        state_ = State::UbxChecksumB;
+        break;
+
+    case State::UbxChecksumB:
+        state_ = State::Hunt;
+        if (byte != ubx_ck_b_)
+        {
+            stats_.checksum_errors++;
+            Hunt(byte);
+            break;
+        }
+        FinishUbx();
+        break;
+    }
+}
+
+void Parser::Hunt(uint8_t byte)
+{
+    if (byte == kNmeaStart)
+    {
+        nmea_checksum_ = 0;
+        nmea_length_ = 0;
+        nmea_address_ = 0;
+        sentence_ = Sentence::Unknown;
+        state_ = State::NmeaAddress;
+    }
+    else if (byte == kUbxSync1)
+    {
+        state_ = State::UbxSync;
+    }
+    else if (byte != '\r' && byte != '\n')
+    {
+        stats_.discarded_bytes++;
+    }
+}
+
+/* Drops the current frame. The offending byte may itself start the next one. */
+void Parser::Fail(uint8_t byte)
+{
+    stats_.framing_errors++;
+    state_ = State::Hunt;
+    Hunt(byte);
+}
+
+void Parser::StepNmeaAddress(uint8_t byte)
+{
+    if (byte == kNmeaFieldSeparator)
+    {
+        nmea_checksum_ ^= byte;
+        switch (nmea_address_ & kNmeaSentenceMask)
+        {
+        case kNmeaGga:
+            sentence_ = Sentence::Gga;
+            position_ = {};
+            break;
+        case kNmeaRmc:
+            sentence_ = Sentence::Rmc;
+            time_ = {};
+            velocity_ = {};
+            rmc_active_ = false;
+            break;
+        default:
+            sentence_ = Sentence::Unknown;
+            break;
+        }
+        field_index_ = 0;
+        BeginNmeaField();
+        state_ = State::NmeaField;
+        return;
+    }
+
+    const bool upper = byte >= 'A' && byte <= 'Z';
+    if ((!upper && !IsDigit(byte)) || ++nmea_length_ > kNmeaMaxLength)
+    {
+        Fail(byte);
+        return;
+    }
+    nmea_checksum_ ^= byte;
+    nmea_address_ = (nmea_address_ << 8) | byte;
+}
+
+void Parser::StepNmeaField(uint8_t byte)
+{
+    if (byte == kNmeaChecksumMarker)
+    {
+        CommitNmeaField();
+        state_ = State::NmeaChecksumHigh;
+        return;
+    }
+    if (!IsPrintable(byte) || byte == kNmeaStart || ++nmea_length_ > kNmeaMaxLength)
+    {
+        Fail(byte);
+        return;
+    }
+
+    nmea_checksum_ ^= byte;
+
+    if (byte == kNmeaFieldSeparator)
+    {
+        CommitNmeaField();
+        field_index_++;
+        BeginNmeaField();
+        return;
+    }
+
+    if (IsDigit(byte))
+    {
+        if (!field_fraction_)
+        {
+            field_digits_ = field_digits_ * 10 + (byte - '0');
+        }
+        else if (field_decimals_ < kNmeaMaxDecimals)
+        {
+            field_digits_ = field_digits_ * 10 + (byte - '0');
+            field_decimals_++;
+        }
+    }
+    else if (byte == '.')
+    {
+        field_fraction_ = true;
+    }
+    else if (byte == '-' && field_length_ == 0)
+    {
+        field_negative_ = true;
+    }
+    else if (field_length_ == 0)
+    {
+        field_char_ = static_cast<char>(byte);
+    }
+    field_length_++;
+}
+
+void Parser::BeginNmeaField()
+{
+    field_digits_ = 0;
+    field_decimals_ = 0;
+    field_length_ = 0;
+    field_fraction_ = false;
+    field_negative_ = false;
+    field_char_ = 0;
+}
+
+void Parser::CommitNmeaField()
+{
+    if (field_length_ == 0)
+    {
+        return;
+    }
+
+    switch (sentence_)
+    {
+    case Sentence::Gga:
+        CommitGgaField();
+        break;
+    case Sentence::Rmc:
+        CommitRmcField();
+        break;
+    case Sentence::Unknown:
+        break;
+    }
+}
+
+/* $--GGA,hhmmss.ss,ddmm.mm,N,dddmm.mm,E,q,ss,h.h,a.a,M,g.g,M,... */
+void Parser::CommitGgaField()
+{
+    enum : uint8_t
+    {
+        kTime,
+        kLatitude,
+        kNorthSouth,
+        kLongitude,
+        kEastWest,
+        kQuality,
+        kSatellites,
+        kHdop,
+        kAltitude,
+    };
+    constexpr uint64_t kQualityDeadReckoning = 6;
+
+    switch (field_index_)
+    {
+    case kLatitude:
+        position_.latitude_e7 = FieldCoordinate();
+        break;
+    case kNorthSouth:
+        if (field_char_ == 'S')
+        {
+            position_.latitude_e7 = -position_.latitude_e7;
+        }
+        break;
+    case kLongitude:
+        position_.longitude_e7 = FieldCoordinate();
+        break;
+    case kEastWest:
+        if (field_char_ == 'W')
+        {
+            position_.longitude_e7 = -position_.longitude_e7;
+        }
+        break;
+    case kQuality:
+        if (field_digits_ == 0)
+        {
+            position_.fix = FixType::None;
+        }
+        else if (field_digits_ == kQualityDeadReckoning)
+        {
+            position_.fix = FixType::DeadReckoning;
+        }
+        else
+        {
+            position_.fix = FixType::Fix3D;
+        }
+        break;
+    case kSatellites:
+        position_.satellites = static_cast<uint8_t>(field_digits_);
+        break;
+    case kAltitude: {
+        const auto millimeters = static_cast<int32_t>(FieldScaled(3));
+        position_.altitude_mm = field_negative_ ? -millimeters : millimeters;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* $--RMC,hhmmss.ss,A,ddmm.mm,N,dddmm.mm,E,s.s,c.c,ddmmyy,... */
+void Parser::CommitRmcField()
+{
+    enum : uint8_t
+    {
+        kTime,
+        kStatus,
+        kLatitude,
+        kNorthSouth,
+        kLongitude,
+        kEastWest,
+        kSpeed,
+        kCourse,
+        kDate,
+    };
+
+    switch (field_index_)
+    {
+    case kTime: {
+        const uint64_t scaled = FieldScaled(kNmeaMaxDecimals);
+        const uint64_t whole = scaled / kNanoseconds;
+        time_.hour = static_cast<uint8_t>(whole / kTenThousand);
+        time_.minute = static_cast<uint8_t>(whole / kHundred % kHundred);
+        time_.second = static_cast<uint8_t>(whole % kHundred);
+        time_.nanosecond = static_cast<int32_t>(scaled % kNanoseconds);
+        time_.time_valid = true;
+        break;
+    }
+    case kStatus:
+        rmc_active_ = field_char_ == 'A';
+        break;
+    case kSpeed:
+        /* knots * 1000 -> mm/s */
+        velocity_.ground_speed_mm_s =
+            static_cast<uint32_t>(FieldScaled(3) * kMetersPerNauticalMile / kSecondsPerHour);
+        break;
+    case kCourse:
+        velocity_.heading_e5 = static_cast<int32_t>(FieldScaled(5));
+        break;
+    case kDate:
+        time_.day = static_cast<uint8_t>(field_digits_ / kTenThousand);
+        time_.month = static_cast<uint8_t>(field_digits_ / kHundred % kHundred);
+        time_.year = static_cast<uint16_t>(kCenturyBase + field_digits_ % kHundred);
+        time_.date_valid = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void Parser::FinishNmea()
+{
+    if (nmea_expected_ != nmea_checksum_)
+    {
+        stats_.checksum_errors++;
+        return;
+    }
+    stats_.nmea_frames++;
+
+    switch (sentence_)
+    {
+    case Sentence::Gga:
+        listener_.OnPosition(position_);
+        break;
+    case Sentence::Rmc:
+        if (rmc_active_)
+        {
+            listener_.OnTime(time_);
+            listener_.OnVelocity(velocity_);
+        }
+        break;
+    case Sentence::Unknown:
+        break;
+    }
+}
+
+/* Current field as a fixed point integer with `decimals` fractional digits */
+uint64_t Parser::FieldScaled(uint8_t decimals) const
+{
+    if (field_decimals_ <= decimals)
+    {
+        return field_digits_ * kPow10[decimals - field_decimals_];
+    }
+    return field_digits_ / kPow10[field_decimals_ - decimals];
+}
+
+/* NMEA coordinates are (d)ddmm.mmmm, convert to degrees * 1e7 */
+int32_t Parser::FieldCoordinate() const
+{
+    const uint64_t scaled = FieldScaled(7);
+    const uint64_t degrees = scaled / (kHundred * kDegreesE7);
+    const uint64_t minutes_e7 = scaled % (kHundred * kDegreesE7);
+    return static_cast<int32_t>(degrees * kDegreesE7 + minutes_e7 / kMinutesPerDegree);
+}
+
+/* 8-bit Fletcher over class, id, length and payload */
+void Parser::UbxChecksum(uint8_t byte)
+{
+    ubx_ck_a_ += byte;
+    ubx_ck_b_ += ubx_ck_a_;
+}
+
+void Parser::StepUbxPayload(uint8_t byte)
+{
+    if (ubx_class_ != kUbxClassNav || ubx_id_ != kUbxIdNavPvt || ubx_length_ != kUbxNavPvtLength)
+    {
+        return;
+    }
+
+    /* Every field we want is 4-byte aligned, so assemble little-endian words */
+    const unsigned lane = ubx_index_ & 3U;
+    ubx_word_ |= static_cast<uint32_t>(byte) << (8U * lane);
+    if (lane == 3)
+    {
+        CommitNavPvtWord(static_cast<uint16_t>(ubx_index_ & ~3U), ubx_word_);
+        ubx_word_ = 0;
+    }
+}
+
+/* UBX-NAV-PVT, offsets from the u-blox M8/M9 interface description */
+void Parser::CommitNavPvtWord(uint16_t offset, uint32_t word)
+{
+    enum : uint16_t
+    {
+        kDate = 4,
+        kClock = 8,
+        kNano = 16,
+        kFix = 20,
+        kLongitude = 24,
+        kLatitude = 28,
+        kHeightMsl = 36,
+        kHorizontalAccuracy = 40,
+        kVelocityNorth = 48,
+        kVelocityEast = 52,
+        kVelocityDown = 56,
+        kGroundSpeed = 60,
+        kHeading = 64,
+    };
+    constexpr uint32_t kValidDate = 0x01;
+    constexpr uint32_t kValidTime = 0x02;
+    constexpr uint32_t kGnssFixOk = 0x01;
+    constexpr uint32_t kHalfWord = 0xFFFF;
+    constexpr unsigned kBitsPerByte = 8;
+
+    /* Little-endian, bytes[0] is the byte at `offset` */
+    uint8_t bytes[sizeof(word)];
+    for (size_t i = 0; i < sizeof(word); i++)
+    {
+        bytes[i] = static_cast<uint8_t>(word >> (i * kBitsPerByte));
+    }
+    const auto signed_word = static_cast<int32_t>(word);
+
+    switch (offset)
+    {
+    case kDate:
+        time_.year = static_cast<uint16_t>(word & kHalfWord);
+        time_.month = bytes[2];
+        time_.day = bytes[3];
+        break;
+    case kClock:
+        time_.hour = bytes[0];
+        time_.minute = bytes[1];
+        time_.second = bytes[2];
+        time_.date_valid = (bytes[3] & kValidDate) != 0;
+        time_.time_valid = (bytes[3] & kValidTime) != 0;
+        break;
+    case kNano:
+        time_.nanosecond = signed_word;
+        break;
+    case kFix:
+        position_.fix = (bytes[1] & kGnssFixOk) != 0 ? static_cast<FixType>(bytes[0]) : FixType::None;
+        position_.satellites = bytes[3];
+        break;
+    case kLongitude:
+        position_.longitude_e7 = signed_word;
+        break;
+    case kLatitude:
+        position_.latitude_e7 = signed_word;
+        break;
+    case kHeightMsl:
+        position_.altitude_mm = signed_word;
+        break;
+    case kHorizontalAccuracy:
+        position_.horizontal_accuracy_mm = word;
+        break;
+    case kVelocityNorth:
+        velocity_.north_mm_s = signed_word;
+        break;
+    case kVelocityEast:
+        velocity_.east_mm_s = signed_word;
+        break;
+    case kVelocityDown:
+        velocity_.down_mm_s = signed_word;
+        break;
+    case kGroundSpeed:
+        velocity_.ground_speed_mm_s = word;
+        break;
+    case kHeading:
+        velocity_.heading_e5 = signed_word;
+        velocity_.ned_valid = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void Parser::FinishUbx()
+{
+    stats_.ubx_frames++;
+
+    if (ubx_class_ == kUbxClassNav && ubx_id_ == kUbxIdNavPvt && ubx_length_ == kUbxNavPvtLength)
+    {
+        listener_.OnTime(time_);
+        listener_.OnPosition(position_);
+        listener_.OnVelocity(velocity_);
+    }
+}
+
+} // namespace gnss
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * Streaming GNSS receiver parser.
+ *
+ * Consumes raw receiver bytes (NMEA 0183 and u-blox UBX interleaved on one
+ * UART) straight out of the DMA ring buffer. Nothing is line buffered: every
+ * field is decoded as its bytes go by and the checksum is accumulated on the
+ * fly, so the parser's whole state is a few dozen bytes and no allocation is
+ * ever made. Decoded messages are only handed to the listener once their
+ * checksum has been verified. Any malformed byte drops the current frame and
+ * the parser hunts for the next '$' or UBX sync word.
+ */
+
+namespace gnss
+{
+
+/* Matches the UBX-NAV-PVT `fixType` encoding */
+enum class FixType : uint8_t
+{
+    None = 0,
+    DeadReckoning = 1,
+    Fix2D = 2,
+    Fix3D = 3,
+    GnssDeadReckoning = 4,
+    TimeOnly = 5,
+};
+
+struct Time
+{
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    bool date_valid;
+    bool time_valid;
+    int32_t nanosecond; /* UBX reports a signed correction to the rounded second */
+};
+
+struct Position
+{
+    int32_t latitude_e7;             /* degrees * 1e7 */
+    int32_t longitude_e7;            /* degrees * 1e7 */
+    int32_t altitude_mm;             /* above mean sea level */
+    uint32_t horizontal_accuracy_mm; /* 0 when the source does not report it */
+    FixType fix;
+    uint8_t satellites;
+};
+
+struct Velocity
+{
+    int32_t north_mm_s;
+    int32_t east_mm_s;
+    int32_t down_mm_s;
+    uint32_t ground_speed_mm_s;
+    int32_t heading_e5; /* degrees * 1e5 */
+    bool ned_valid;     /* NMEA only reports speed and course over ground */
+};
+
+struct Stats
+{
+    uint32_t nmea_frames;
+    uint32_t ubx_frames;
+    uint32_t checksum_errors;
+    uint32_t framing_errors;
+    uint32_t discarded_bytes;
+};
+
+/* Receives decoded messages. Called from inside `Parser::Consume()`. */
+class Listener
+{
+public:
+    virtual void OnTime(const Time &time)
+    {
+        (void)time;
+    }
+
+    virtual void OnPosition(const Position &position)
+    {
+        (void)position;
+    }
+
+    virtual void OnVelocity(const Velocity &velocity)
+    {
+        (void)velocity;
+    }
+
+protected:
+    ~Listener() = default;
+};
+
+class Parser
+{
+public:
+    explicit Parser(Listener &listener);
+
+    /* Feed the next run of received bytes. May be called with any split. */
+    void Consume(std::span<const uint8_t> bytes);
+
+    /* Convenience for a DMA ring buffer whose valid region wraps around */
+    void Consume(std::span<const uint8_t> first, std::span<const uint8_t> second);
+
+    /* Drop any partially received frame */
+    void Reset();
+
+    [[nodiscard]] const Stats &GetStats() const
+    {
+        return stats_;
+    }
+
+private:
+    enum class State : uint8_t
+    {
+        Hunt,
+        NmeaAddress,
+        NmeaField,
+        NmeaChecksumHigh,
+        NmeaChecksumLow,
+        UbxSync,
+        UbxClass,
+        UbxId,
+        UbxLengthLow,
+        UbxLengthHigh,
+        UbxPayload,
+        UbxChecksumA,
+        UbxChecksumB,
+    };
+
+    enum class Sentence : uint8_t
+    {
+        Unknown,
+        Gga,
+        Rmc,
+    };
+
+    void Step(uint8_t byte);
+    void Hunt(uint8_t byte);
+    void Fail(uint8_t byte);
+
+    void StepNmeaAddress(uint8_t byte);
+    void StepNmeaField(uint8_t byte);
+    void BeginNmeaField();
+    void CommitNmeaField();
+    void CommitGgaField();
+    void CommitRmcField();
+    void FinishNmea();
+    [[nodiscard]] uint64_t FieldScaled(uint8_t decimals) const;
+    [[nodiscard]] int32_t FieldCoordinate() const;
+
+    void UbxChecksum(uint8_t byte);
+    void StepUbxPayload(uint8_t byte);
+    void CommitNavPvtWord(uint16_t offset, uint32_t word);
+    void FinishUbx();
+
+    Listener &listener_;
+    Stats stats_{};
+    State state_ = State::Hunt;
+
+    /* NMEA framing */
+    Sentence sentence_ = Sentence::Unknown;
+    uint8_t nmea_checksum_ = 0;
+    uint8_t nmea_expected_ = 0;
+    uint8_t nmea_length_ = 0;
+    uint32_t nmea_address_ = 0;
+    uint8_t field_index_ = 0;
+
+    /* Current NMEA field, decoded in place */
+    uint64_t field_digits_ = 0;
+    uint8_t field_decimals_ = 0;
+    uint8_t field_length_ = 0;
+    bool field_fraction_ = false;
+    bool field_negative_ = false;
+    char field_char_ = 0;
+
+    /* UBX framing */
+    uint8_t ubx_class_ = 0;
+    uint8_t ubx_id_ = 0;
+    uint16_t ubx_length_ = 0;
+    uint16_t ubx_index_ = 0;
+    uint8_t ubx_ck_a_ = 0;
+    uint8_t ubx_ck_b_ = 0;
+    uint32_t ubx_word_ = 0;
+
+    /* Message being assembled, only published after the checksum passes */
+    Time time_{};
+    Position position_{};
+    Velocity velocity_{};
+    bool rmc_active_ = false;
+};
+
+} // namespace gnss
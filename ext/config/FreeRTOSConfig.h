@@ -77,7 +77,7 @@ function. */
 #define configCPU_CLOCK_HZ (SystemCoreClock)
 #define configTICK_RATE_HZ ((TickType_t)1000)
 
-#define configMINIMAL_STACK_SIZE ((uint16_t)512)
+#define configMINIMAL_STACK_SIZE ((uint16_t)128)
 #define configTOTAL_HEAP_SIZE ((size_t)(12 * 1024))
 #define configMAX_TASK_NAME_LEN (16)
 #define configUSE_TRACE_FACILITY 1
@@ -85,7 +85,7 @@ function. */
 #define configIDLE_SHOULD_YIELD 1
 #define configUSE_MUTEXES 1
 #define configQUEUE_REGISTRY_SIZE 8
-#define configCHECK_FOR_STACK_OVERFLOW 0
+#define configCHECK_FOR_STACK_OVERFLOW 2
 #define configUSE_RECURSIVE_MUTEXES 1
 #define configUSE_MALLOC_FAILED_HOOK 0
 #define configUSE_APPLICATION_TASK_TAG 0
@@ -110,10 +110,11 @@ function. */
 #define configUSE_TIMERS 1
 #define configTIMER_TASK_PRIORITY (2)
 #define configTIMER_QUEUE_LENGTH 10
-#define configTIMER_TASK_STACK_DEPTH 256
+#define configTIMER_TASK_STACK_DEPTH 128
 
-/* required for idle task and timer task */
-#define configKERNEL_PROVIDED_STATIC_MEMORY 1
+/* Idle and timer task memory comes from lib/stack_monitor, so the stack analysis covers them */
+#define configKERNEL_PROVIDED_STATIC_MEMORY 0
+#define configSTACK_DEPTH_TYPE uint32_t
 
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
@@ -161,6 +162,25 @@ header file. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+
+/* Mutex priority inheritance tracing, implemented in lib/lock_profiler. Enabled by the LOCK_PROFILER build option. */
+#if defined(LOCK_PROFILER) && LOCK_PROFILER && !defined(__ASSEMBLER__)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void lock_profiler_blocking(void *queue);
+void lock_profiler_priority_inherit(void *holder, unsigned long priority);
+void lock_profiler_priority_disinherit(void *holder, unsigned long priority);
+#ifdef __cplusplus
+}
+#endif
+
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) lock_profiler_blocking(pxQueue)
+#define traceTASK_PRIORITY_INHERIT(pxTCBOfMutexHolder, uxInheritedPriority)                                            \
+    lock_profiler_priority_inherit(pxTCBOfMutexHolder, uxInheritedPriority)
+#define traceTASK_PRIORITY_DISINHERIT(pxTCBOfMutexHolder, uxOriginalPriority)                                          \
+    lock_profiler_priority_disinherit(pxTCBOfMutexHolder, uxOriginalPriority)
+#endif
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
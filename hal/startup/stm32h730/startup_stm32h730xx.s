@@ -60,10 +60,27 @@ defined in linker script */
 Reset_Handler:
   ldr   sp, =_estack      /* set stack pointer */
 
+/* Start the DWT cycle counter, the boot profile is timestamped from it */
+  ldr r0, =0xE000EDFC     /* CoreDebug->DEMCR */
+  ldr r1, [r0]
+  orr r1, r1, #0x01000000 /* TRCENA */
+  str r1, [r0]
+  ldr r0, =0xE0001000     /* DWT->CTRL */
+  ldr r1, =0xC5ACCE55
+  str r1, [r0, #0xFB0]    /* unlock DWT->LAR */
+  movs r1, #0
+  str r1, [r0, #4]        /* DWT->CYCCNT */
+  ldr r1, [r0]
+  orr r1, r1, #1          /* CYCCNTENA */
+  str r1, [r0]
+
 /* Call the ExitRun0Mode function to configure the power supply */
   bl  ExitRun0Mode
 /* Call the clock system initialization function.*/
   bl  SystemInit
+/* Reset marks are kept in r5-r7 until .bss is zeroed, nothing below touches them */
+  ldr r5, =0xE0001004
+  ldr r5, [r5]
 
 /* Copy the data segment initializers from flash to SRAM */
   ldr r0, =_sdata
@@ -81,6 +98,8 @@ LoopCopyDataInit:
   adds r4, r0, r3
   cmp r4, r1
   bcc CopyDataInit
+  ldr r6, =0xE0001004
+  ldr r6, [r6]
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
@@ -94,9 +113,21 @@ FillZerobss:
 LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
+  ldr r7, =0xE0001004
+  ldr r7, [r7]
+
+/* Hand the reset marks to the boot profile (boot_reset_cycles, lib/boot) */
+  ldr r0, =boot_reset_cycles
+  str r5, [r0]
+  str r6, [r0, #4]
+  str r7, [r0, #8]
 
 /* Call static constructors */
     bl __libc_init_array
+  ldr r0, =boot_reset_cycles
+  ldr r1, =0xE0001004
+  ldr r1, [r1]
+  str r1, [r0, #12]
 /* Call the application's entry point.*/
   bl  main
   bx  lr
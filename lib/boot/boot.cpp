@@ -0,0 +1,296 @@
+#include "boot.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "task_stack.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <iterator>
+
+#define BOOT_TASK_STACK_SIZE 256
+#define PROFILE_VERSION 1
+
+/* Written by `Reset_Handler` once .bss is zeroed, see startup_stm32h730xx.s */
+extern "C" uint32_t boot_reset_cycles[boot::kResetMarkCount];
+uint32_t boot_reset_cycles[boot::kResetMarkCount];
+
+namespace
+{
+
+TASK_STACK(BootTask, BOOT_TASK_STACK_SIZE);
+StaticTask_t boot_tcb;
+
+const char *StatusName(boot::Status status)
+{
+    switch (status)
+    {
+    case boot::Status::Waiting:
+        return "waiting";
+    case boot::Status::Running:
+        return "running";
+    case boot::Status::Done:
+        return "done";
+    case boot::Status::Failed:
+        return "FAILED";
+    case boot::Status::Skipped:
+        return "SKIPPED";
+    }
+    return "?";
+}
+
+uint8_t *Put32(uint8_t *out, uint32_t value)
+{
+    for (unsigned i = 0; i < sizeof(value); i++)
+    {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+    return out;
+}
+
+void WaitTick()
+{
+    vTaskDelay(1);
+}
+
+void BootTask(void *argument)
+{
+    auto &sequencer = *static_cast<boot::Sequencer *>(argument);
+
+    sequencer.Run(boot::Phase::Deferred, WaitTick);
+    sequencer.Print();
+
+    vTaskDelete(NULL);
+}
+
+} // namespace
+
+namespace boot
+{
+
+size_t Profile::Serialize(std::span<uint8_t> out) const
+{
+    const size_t length = SerializedSize(count);
+    if (out.size() < length)
+    {
+        return 0;
+    }
+
+    uint8_t *cursor = out.data();
+    *cursor++ = PROFILE_VERSION;
+    *cursor++ = count;
+    for (const uint32_t mark : reset)
+    {
+        cursor = Put32(cursor, mark);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        *cursor++ = static_cast<uint8_t>(stages[i].status);
+        cursor = Put32(cursor, stages[i].start);
+        cursor = Put32(cursor, stages[i].ready);
+    }
+    return length;
+}
+
+Sequencer::Sequencer(std::span<const Stage> stages, uint32_t (*clock)()) : stages_(stages), clock_(clock)
+{
+    profile_.count = static_cast<uint8_t>(stages.size() < kMaxStages ? stages.size() : kMaxStages);
+}
+
+bool Sequencer::Validate() const
+{
+    if (stages_.size() > kMaxStages)
+    {
+        return false;
+    }
+
+    const uint32_t known = stages_.size() == kMaxStages ? ~0U : (1U << stages_.size()) - 1;
+    for (const Stage &stage : stages_)
+    {
+        if ((stage.dependencies & ~known) != 0 || stage.start == NULL)
+        {
+            return false;
+        }
+        for (size_t dep = 0; dep < stages_.size(); dep++)
+        {
+            const bool depends = (stage.dependencies & (1U << dep)) != 0;
+            if (depends && stage.phase == Phase::Early && stages_[dep].phase == Phase::Deferred)
+            {
+                return false;
+            }
+        }
+    }
+
+    /* Kahn's algorithm on the bitmasks: a cycle leaves stages that never become ready */
+    uint32_t resolved = 0;
+    bool progress = true;
+    while (progress && resolved != known)
+    {
+        progress = false;
+        for (size_t i = 0; i < stages_.size(); i++)
+        {
+            const uint32_t bit = 1U << i;
+            if ((resolved & bit) == 0 && (stages_[i].dependencies & ~resolved) == 0)
+            {
+                resolved |= bit;
+                progress = true;
+            }
+        }
+    }
+    return resolved == known;
+}
+
+bool Sequencer::Run(Phase phase, void (*wait)())
+{
+    /* Static sequencers are constructed before the last mark is taken */
+    for (size_t i = 0; i < kResetMarkCount; i++)
+    {
+        profile_.reset[i] = boot_reset_cycles[i];
+    }
+
+    bool pending = true;
+    while (pending)
+    {
+        pending = false;
+        bool progress = false;
+
+        for (size_t i = 0; i < profile_.count; i++)
+        {
+            if (stages_[i].phase != phase)
+            {
+                continue;
+            }
+            progress |= Advance(phase, i);
+
+            const Status status = profile_.stages[i].status;
+            pending |= status == Status::Waiting || status == Status::Running;
+        }
+
+        if (pending && !progress)
+        {
+            if (wait != NULL)
+            {
+                wait();
+            }
+        }
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < profile_.count; i++)
+    {
+        ok &= stages_[i].phase != phase || profile_.stages[i].status == Status::Done;
+    }
+    return ok;
+}
+
+/* Moves stage `index` along by at most one step. Returns true if its status changed. */
+bool Sequencer::Advance(Phase phase, size_t index)
+{
+    const Stage &stage = stages_[index];
+    StageRecord &record = profile_.stages[index];
+
+    switch (record.status)
+    {
+    case Status::Waiting: {
+        bool ready = true;
+        for (size_t dep = 0; dep < profile_.count; dep++)
+        {
+            if ((stage.dependencies & (1U << dep)) == 0)
+            {
+                continue;
+            }
+            const Status status = profile_.stages[dep].status;
+            if (status == Status::Failed || status == Status::Skipped)
+            {
+                record.status = Status::Skipped;
+                return true;
+            }
+            /* A dependency of a later phase can never finish in this one */
+            if (stages_[dep].phase != phase && status != Status::Done)
+            {
+                record.status = Status::Skipped;
+                return true;
+            }
+            ready &= status == Status::Done;
+        }
+        if (!ready)
+        {
+            return false;
+        }
+
+        record.start = clock_();
+        if (!stage.start())
+        {
+            record.ready = clock_();
+            record.status = Status::Failed;
+        }
+        else if (stage.poll == NULL)
+        {
+            record.ready = clock_();
+            record.status = Status::Done;
+        }
+        else
+        {
+            record.status = Status::Running;
+        }
+        return true;
+    }
+
+    case Status::Running:
+        switch (stage.poll())
+        {
+        case Poll::Busy:
+            return false;
+        case Poll::Ready:
+            record.status = Status::Done;
+            break;
+        case Poll::Failed:
+            record.status = Status::Failed;
+            break;
+        }
+        record.ready = clock_();
+        return true;
+
+    case Status::Done:
+    case Status::Failed:
+    case Status::Skipped:
+        break;
+    }
+    return false;
+}
+
+void Sequencer::Print() const
+{
+    printf("[boot] reset: init %lu, data %lu, bss %lu, ctors %lu\n",
+           static_cast<unsigned long>(profile_.reset[kSystemInitDone]),
+           static_cast<unsigned long>(profile_.reset[kDataCopied]),
+           static_cast<unsigned long>(profile_.reset[kBssZeroed]),
+           static_cast<unsigned long>(profile_.reset[kConstructorsDone]));
+
+    for (size_t i = 0; i < profile_.count; i++)
+    {
+        const StageRecord &record = profile_.stages[i];
+        printf("[boot] %-16s %-7s start %10lu took %10lu\n", stages_[i].name, StatusName(record.status),
+               static_cast<unsigned long>(record.start), static_cast<unsigned long>(record.ready - record.start));
+    }
+}
+
+uint32_t CycleCount()
+{
+#if defined(__ARM_ARCH)
+    /* DWT->CYCCNT */
+    return *reinterpret_cast<volatile uint32_t *>(0xE0001004);
+#else
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+}
+
+void StartDeferred(Sequencer &sequencer)
+{
+    xTaskCreateStatic(BootTask, "Boot", std::size(BootTask_stack), &sequencer, tskIDLE_PRIORITY + 1, BootTask_stack,
+                      &boot_tcb);
+}
+
+} // namespace boot
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <span>
+
+/*
+ * Staged boot sequencing and profiling.
+ *
+ * Bring-up is split into stages that each name the stages they depend on.
+ * The sequencer starts every stage whose dependencies are done, in table
+ * order. A stage with a `poll` function only kicks its hardware off in
+ * `start` (e.g. enable the PLL) and is polled for completion while the
+ * sequencer keeps starting other ready stages (e.g. initializing RAM regions),
+ * so independent bring-up overlaps instead of busy waiting in series.
+ *
+ * `Phase::Early` stages run from `main()` before the scheduler starts and
+ * should be what is needed to get to a safe, ready-to-fire state.
+ * `Phase::Deferred` stages run from a low priority task once the scheduler is
+ * up. Every stage's start and ready time is recorded in a `Profile`, together
+ * with the timestamps `Reset_Handler` takes before `main()`.
+ *
+ * The sequencer itself has no RTOS or hardware dependencies so stage graphs
+ * can be exercised on Native.
+ */
+
+namespace boot
+{
+
+constexpr size_t kMaxStages = 32;
+
+enum class Phase : uint8_t
+{
+    Early,
+    Deferred,
+};
+
+enum class Poll : uint8_t
+{
+    Busy,
+    Ready,
+    Failed,
+};
+
+enum class Status : uint8_t
+{
+    Waiting,
+    Running,
+    Done,
+    Failed,
+    Skipped, /* a dependency failed */
+};
+
+struct Stage
+{
+    const char *name;
+    Phase phase;
+    uint32_t dependencies; /* bit `i` set = depends on stage `i` of the table */
+    bool (*start)();       /* false on failure */
+    Poll (*poll)();        /* NULL when done once `start` returns. Must time out by itself. */
+};
+
+/* Dependency mask for `Stage::dependencies`, e.g. `After(kClocks, kRam)` */
+template <typename... Ids>
+constexpr uint32_t After(Ids... ids)
+{
+    return ((1U << static_cast<uint32_t>(ids)) | ... | 0U);
+}
+
+/* Timestamps `Reset_Handler` takes before `main()`, in CPU cycles */
+enum ResetMark : uint8_t
+{
+    kSystemInitDone,
+    kDataCopied,
+    kBssZeroed,
+    kConstructorsDone,
+    kResetMarkCount,
+};
+
+struct StageRecord
+{
+    uint32_t start;
+    uint32_t ready;
+    Status status;
+};
+
+struct Profile
+{
+    uint32_t reset[kResetMarkCount];
+    StageRecord stages[kMaxStages];
+    uint8_t count;
+
+    /*
+     * Packs the profile for downlink, little-endian:
+     * u8 version, u8 stage count, u32 reset marks[4],
+     * then per stage: u8 status, u32 start, u32 ready.
+     * Returns the number of bytes written, 0 if `out` is too small.
+     */
+    size_t Serialize(std::span<uint8_t> out) const;
+
+    /* Bytes `Serialize()` writes for a profile of `stages` stages */
+    static constexpr size_t SerializedSize(size_t stages)
+    {
+        return 2 + sizeof(reset) + stages * (1 + 2 * sizeof(uint32_t));
+    }
+};
+
+class Sequencer
+{
+public:
+    /* `clock` timestamps every stage, it must be usable before any stage runs */
+    Sequencer(std::span<const Stage> stages, uint32_t (*clock)());
+
+    /* Rejects too many stages, unknown or cyclic dependencies and early stages depending on deferred ones */
+    [[nodiscard]] bool Validate() const;
+
+    /*
+     * Runs every stage of `phase` to completion. `wait` is called whenever all
+     * remaining stages are polling, e.g. to sleep a tick; NULL busy polls.
+     * Returns false if any stage of `phase` failed or was skipped.
+     */
+    bool Run(Phase phase, void (*wait)() = NULL);
+
+    [[nodiscard]] Status GetStatus(size_t stage) const
+    {
+        return profile_.stages[stage].status;
+    }
+
+    [[nodiscard]] const Profile &GetProfile() const
+    {
+        return profile_;
+    }
+
+    /* Prints one line per stage with its start time and duration */
+    void Print() const;
+
+private:
+    bool Advance(Phase phase, size_t index);
+
+    std::span<const Stage> stages_;
+    uint32_t (*clock_)();
+    Profile profile_{};
+};
+
+/* Free running cycle counter, started by `Reset_Handler` (nanoseconds on Native) */
+uint32_t CycleCount();
+
+/* Creates a low priority task that runs the deferred stages, prints the profile and exits */
+void StartDeferred(Sequencer &sequencer);
+
+} // namespace boot
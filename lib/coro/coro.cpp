@@ -0,0 +1,428 @@
+#include "coro.h"
+
+#include "task.h"
+
+namespace
+{
+
+union Block
+{
+    Block *next;
+    alignas(alignof(max_align_t)) uint8_t frame[CORO_FRAME_SIZE];
+};
+
+Block blocks[CORO_FRAME_COUNT];
+Block *free_list;
+size_t in_use;
+size_t high_water_mark;
+size_t largest_frame;
+bool initialized;
+
+/* Completions are finished from tasks and interrupts alike */
+UBaseType_t EnterCritical(bool from_isr)
+{
+    if (from_isr)
+    {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+    taskENTER_CRITICAL();
+    return 0;
+}
+
+void ExitCritical(bool from_isr, UBaseType_t state)
+{
+    if (from_isr)
+    {
+        taskEXIT_CRITICAL_FROM_ISR(state);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+} // namespace
+
+namespace coro
+{
+
+void *FramePool::Allocate(size_t size)
+{
+    if (size > sizeof(Block))
+    {
+        return nullptr;
+    }
+
+    void *frame = nullptr;
+    taskENTER_CRITICAL();
+    if (!initialized)
+    {
+        for (Block &block : blocks)
+        {
+            block.next = free_list;
+            free_list = &block;
+        }
+        initialized = true;
+    }
+    if (free_list != nullptr)
+    {
+        frame = free_list;
+        free_list = free_list->next;
+        in_use++;
+        high_water_mark = in_use > high_water_mark ? in_use : high_water_mark;
+        largest_frame = size > largest_frame ? size : largest_frame;
+    }
+    taskEXIT_CRITICAL();
+    return frame;
+}
+
+void FramePool::Free(void *frame)
+{
+    auto *block = static_cast<Block *>(frame);
+
+    taskENTER_CRITICAL();
+    block->next = free_list;
+    free_list = block;
+    in_use--;
+    taskEXIT_CRITICAL();
+}
+
+size_t FramePool::InUse()
+{
+    return in_use;
+}
+
+size_t FramePool::HighWaterMark()
+{
+    return high_water_mark;
+}
+
+size_t FramePool::LargestFrame()
+{
+    return largest_frame;
+}
+
+std::coroutine_handle<> Task::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> handle) noexcept
+{
+    promise_type &promise = handle.promise();
+    if (promise.continuation)
+    {
+        return promise.continuation;
+    }
+    /* Nobody owns a spawned coroutine, it frees its own frame */
+    if (promise.detached)
+    {
+        handle.destroy();
+    }
+    return std::noop_coroutine();
+}
+
+Task::Task(Task &&other) noexcept : handle_(other.handle_)
+{
+    other.handle_ = nullptr;
+}
+
+Task &Task::operator=(Task &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+        handle_ = other.handle_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+Task::~Task()
+{
+    if (handle_)
+    {
+        handle_.destroy();
+    }
+}
+
+std::coroutine_handle<> Task::await_suspend(std::coroutine_handle<> caller) noexcept
+{
+    handle_.promise().continuation = caller;
+    return handle_;
+}
+
+Executor::Executor()
+{
+    queue_ = xQueueCreateStatic(CORO_READY_QUEUE_LENGTH, sizeof(void *), queue_buffer_, &queue_storage_);
+}
+
+bool Executor::Spawn(Task task)
+{
+    if (!task)
+    {
+        return false;
+    }
+
+    std::coroutine_handle<Task::promise_type> handle = task.handle_;
+    handle.promise().detached = true;
+    task.handle_ = nullptr;
+    if (!Post(handle))
+    {
+        handle.destroy();
+        return false;
+    }
+    return true;
+}
+
+bool Executor::Post(std::coroutine_handle<> handle)
+{
+    void *address = handle.address();
+    return xQueueSend(queue_, &address, 0) == pdPASS;
+}
+
+void Executor::PostFromIsr(std::coroutine_handle<> handle)
+{
+    void *address = handle.address();
+    BaseType_t woken = pdFALSE;
+
+    /* A dropped handle would hang its sequence forever: the queue must hold every pending completion */
+    const BaseType_t sent = xQueueSendFromISR(queue_, &address, &woken);
+    configASSERT(sent == pdPASS);
+    portYIELD_FROM_ISR(woken);
+}
+
+bool Executor::RunOnce(TickType_t wait)
+{
+    void *address = nullptr;
+    if (xQueueReceive(queue_, &address, ExpireTimeouts(wait)) != pdPASS &&
+        (timed_ == nullptr || xQueueReceive(queue_, &address, ExpireTimeouts(0)) != pdPASS))
+    {
+        return false;
+    }
+    std::coroutine_handle<>::from_address(address).resume();
+    return true;
+}
+
+TickType_t Executor::ExpireTimeouts(TickType_t wait)
+{
+    if (timed_ == nullptr)
+    {
+        return wait;
+    }
+
+    const TickType_t now = xTaskGetTickCount();
+    for (Completion *completion = timed_; completion != nullptr; completion = completion->next_timed_)
+    {
+        completion->Expire(now);
+        const TickType_t left = completion->TicksLeft(now);
+        wait = left < wait ? left : wait;
+    }
+    return wait;
+}
+
+void Executor::Run()
+{
+    for (;;)
+    {
+        RunOnce(portMAX_DELAY);
+    }
+}
+
+Completion::Completion(Executor &executor, TickType_t timeout, Abort abort, void *context)
+    : executor_(executor), timeout_(timeout), abort_(abort), context_(context)
+{
+    if (timeout_ != portMAX_DELAY)
+    {
+        taskENTER_CRITICAL();
+        next_timed_ = executor_.timed_;
+        executor_.timed_ = this;
+        taskEXIT_CRITICAL();
+    }
+}
+
+Completion::~Completion()
+{
+    taskENTER_CRITICAL();
+    for (Completion **link = &executor_.timed_; *link != nullptr; link = &(*link)->next_timed_)
+    {
+        if (*link == this)
+        {
+            *link = next_timed_;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+void Completion::Complete(Status status)
+{
+    Finish(status, false);
+}
+
+void Completion::CompleteFromIsr(Status status)
+{
+    Finish(status, true);
+}
+
+bool Completion::Enqueue(Waiter &waiter)
+{
+    waiter.status = Status::Busy;
+    waiter.next = nullptr;
+
+    taskENTER_CRITICAL();
+    if (tail_ != nullptr)
+    {
+        tail_->next = &waiter;
+    }
+    else
+    {
+        head_ = &waiter;
+    }
+    tail_ = &waiter;
+    taskEXIT_CRITICAL();
+
+    return StartNext(false, &waiter);
+}
+
+void Completion::Finish(Status status, bool from_isr)
+{
+    const UBaseType_t state = EnterCritical(from_isr);
+    Waiter *waiter = started_ ? PopFront() : nullptr;
+    ExitCritical(from_isr, state);
+
+    /* Nothing in flight: a late completion of a transfer that already timed out */
+    if (waiter == nullptr)
+    {
+        return;
+    }
+    waiter->status = status;
+    Post(*waiter, from_isr);
+    StartNext(from_isr, nullptr);
+}
+
+bool Completion::StartNext(bool from_isr, const Waiter *caller)
+{
+    for (;;)
+    {
+        UBaseType_t state = EnterCritical(from_isr);
+        Waiter *waiter = started_ ? nullptr : head_;
+        if (waiter != nullptr)
+        {
+            started_ = true;
+            started_at_ = from_isr ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+        }
+        ExitCritical(from_isr, state);
+
+        if (waiter == nullptr || waiter->start(*waiter))
+        {
+            return true;
+        }
+
+        /* Nothing completes a transfer that never started, so the waiter is still at the front */
+        state = EnterCritical(from_isr);
+        PopFront();
+        ExitCritical(from_isr, state);
+        waiter->status = Status::Error;
+        if (waiter == caller)
+        {
+            return false;
+        }
+        Post(*waiter, from_isr);
+    }
+}
+
+/* Called with interrupts masked */
+Completion::Waiter *Completion::PopFront()
+{
+    Waiter *waiter = head_;
+    head_ = waiter->next;
+    if (head_ == nullptr)
+    {
+        tail_ = nullptr;
+    }
+    started_ = false;
+    return waiter;
+}
+
+void Completion::Post(Waiter &waiter, bool from_isr)
+{
+    if (from_isr)
+    {
+        executor_.PostFromIsr(waiter.handle);
+        return;
+    }
+    const bool posted = executor_.Post(waiter.handle);
+    configASSERT(posted);
+}
+
+void Completion::Expire(TickType_t now)
+{
+    taskENTER_CRITICAL();
+    Waiter *waiter = started_ && now - started_at_ >= timeout_ ? PopFront() : nullptr;
+    taskEXIT_CRITICAL();
+
+    if (waiter == nullptr)
+    {
+        return;
+    }
+    if (abort_ != nullptr)
+    {
+        abort_(context_);
+    }
+    waiter->status = Status::Timeout;
+    Post(*waiter, false);
+    StartNext(false, nullptr);
+}
+
+/* Read without masking interrupts: whatever starts a transfer from an interrupt also posts, waking the executor */
+TickType_t Completion::TicksLeft(TickType_t now) const
+{
+    if (!started_)
+    {
+        return portMAX_DELAY;
+    }
+    const TickType_t elapsed = now - started_at_;
+    return elapsed < timeout_ ? timeout_ - elapsed : 0;
+}
+
+bool Event::await_suspend(std::coroutine_handle<> handle)
+{
+    taskENTER_CRITICAL();
+    const bool suspend = !set_;
+    set_ = false;
+    if (suspend)
+    {
+        waiter_ = handle;
+    }
+    taskEXIT_CRITICAL();
+    return suspend;
+}
+
+void Event::Set()
+{
+    taskENTER_CRITICAL();
+    std::coroutine_handle<> waiter = waiter_;
+    waiter_ = nullptr;
+    set_ = !waiter;
+    taskEXIT_CRITICAL();
+    if (waiter)
+    {
+        const bool posted = executor_.Post(waiter);
+        configASSERT(posted);
+    }
+}
+
+void Event::SetFromIsr()
+{
+    const UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+    std::coroutine_handle<> waiter = waiter_;
+    waiter_ = nullptr;
+    set_ = !waiter;
+    taskEXIT_CRITICAL_FROM_ISR(state);
+    if (waiter)
+    {
+        executor_.PostFromIsr(waiter);
+    }
+}
+
+} // namespace coro
@@ -0,0 +1,363 @@
+#pragma once
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <coroutine>
+
+/*
+ * Coroutine executor for interrupt driven I/O.
+ *
+ * A driver that blocks on a HAL transfer no longer needs its own task and
+ * stack: I/O sequences are written as `coro::Task` coroutines, `co_await` a
+ * `Completion` that the driver's completion interrupt fires, and many of them
+ * share one FreeRTOS task running an `Executor`. A suspended sequence costs
+ * its coroutine frame instead of a whole task stack.
+ *
+ * Frames come from a static pool of `CORO_FRAME_SIZE` byte blocks, since the
+ * toolchain has no exceptions and we do not use the heap. A coroutine whose
+ * frame does not fit (or that finds the pool empty) yields an empty `Task`.
+ */
+
+#ifndef CORO_FRAME_SIZE
+#define CORO_FRAME_SIZE 256
+#endif
+
+#ifndef CORO_FRAME_COUNT
+#define CORO_FRAME_COUNT 16
+#endif
+
+#ifndef CORO_READY_QUEUE_LENGTH
+#define CORO_READY_QUEUE_LENGTH 16
+#endif
+
+/* How long a driver transfer may take before it is aborted and completes with `Status::Timeout` */
+#ifndef CORO_TRANSFER_TIMEOUT_MS
+#define CORO_TRANSFER_TIMEOUT_MS 100
+#endif
+
+namespace coro
+{
+
+enum class Status : uint8_t
+{
+    Ok,
+    Error,
+    Busy,    /* Still in flight, or waiting for the ones ahead of it */
+    Timeout, /* No completion within the `Completion`'s timeout */
+};
+
+/* Fixed block allocator backing every coroutine frame */
+class FramePool
+{
+public:
+    static void *Allocate(size_t size);
+    static void Free(void *frame);
+
+    /* Blocks currently in use, and the most ever in use at once */
+    static size_t InUse();
+    static size_t HighWaterMark();
+
+    /* Largest frame allocated so far, to size CORO_FRAME_SIZE */
+    static size_t LargestFrame();
+};
+
+class Executor;
+class Completion;
+
+class Task
+{
+public:
+    struct promise_type
+    {
+        static void *operator new(size_t size) noexcept
+        {
+            return FramePool::Allocate(size);
+        }
+
+        static void operator delete(void *frame) noexcept
+        {
+            FramePool::Free(frame);
+        }
+
+        static Task get_return_object_on_allocation_failure() noexcept
+        {
+            return Task();
+        }
+
+        Task get_return_object() noexcept
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        FinalAwaiter final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            configASSERT(0);
+        }
+
+        std::coroutine_handle<> continuation;
+        bool detached = false;
+    };
+
+    Task() = default;
+    Task(Task &&other) noexcept;
+    Task &operator=(Task &&other) noexcept;
+    ~Task();
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    /* False if the frame could not be allocated */
+    explicit operator bool() const
+    {
+        return static_cast<bool>(handle_);
+    }
+
+    /*
+     * `co_await child()` runs `child` to completion before resuming the caller,
+     * and gives `Status::Error` if `child` never ran because it had no frame.
+     */
+    bool await_ready() const noexcept
+    {
+        return !handle_ || handle_.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept;
+
+    [[nodiscard]] Status await_resume() const noexcept
+    {
+        return handle_ ? Status::Ok : Status::Error;
+    }
+
+private:
+    friend class Executor;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/* Resumes coroutines, in the order they became ready, on one FreeRTOS task */
+class Executor
+{
+public:
+    Executor();
+
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    /* Takes ownership of `task` and queues it. False if it has no frame or the queue is full. */
+    bool Spawn(Task task);
+
+    /* Queue a suspended coroutine for resumption, from a task or an interrupt respectively */
+    bool Post(std::coroutine_handle<> handle);
+    void PostFromIsr(std::coroutine_handle<> handle);
+
+    /*
+     * Resumes at most one coroutine, waiting up to `wait` ticks for one, and
+     * times out overdue transfers. False if none was ready.
+     */
+    bool RunOnce(TickType_t wait);
+
+    /* Body of the executor's task, never returns */
+    [[noreturn]] void Run();
+
+private:
+    friend class Completion;
+
+    /* Times out overdue transfers, and returns `wait` cut short at the next deadline */
+    TickType_t ExpireTimeouts(TickType_t wait);
+
+    StaticQueue_t queue_storage_;
+    uint8_t queue_buffer_[CORO_READY_QUEUE_LENGTH * sizeof(void *)];
+    QueueHandle_t queue_;
+    Completion *timed_ = nullptr; /* Completions with a timeout */
+};
+
+/*
+ * The operations of a driver, one in flight at a time, finished from its
+ * completion interrupt.
+ *
+ * ```cpp
+ * coro::Status status = co_await completion.Wait([&] { return HAL_UART_Transmit_IT(...) == HAL_OK; });
+ * ```
+ *
+ * `start` kicks the hardware off and returns false if it could not, in which
+ * case the caller gets `Status::Error`. The waiter is recorded before `start`
+ * runs, so an interrupt that fires before the caller has finished suspending
+ * is not lost. Waiters queue in FIFO order while an operation is in flight;
+ * each `start` runs when the one before it completes, possibly from that
+ * completion's interrupt.
+ *
+ * With a `timeout` (in ticks) the executor fails an operation that has not
+ * completed in time with `Status::Timeout`, calls `abort` to stop the
+ * hardware and starts the next waiter. A completion that arrives afterwards is
+ * ignored. A Completion with a timeout must be destroyed on its executor's
+ * task.
+ */
+class Completion
+{
+public:
+    using Abort = void (*)(void *context);
+
+    explicit Completion(Executor &executor, TickType_t timeout = portMAX_DELAY, Abort abort = nullptr,
+                        void *context = nullptr);
+    ~Completion();
+
+    Completion(const Completion &) = delete;
+    Completion &operator=(const Completion &) = delete;
+
+    /* A queued operation, kept in the waiting coroutine's frame */
+    struct Waiter
+    {
+        explicit Waiter(bool (*launch)(Waiter &waiter)) : start(launch)
+        {
+        }
+
+        bool (*start)(Waiter &waiter);
+        std::coroutine_handle<> handle;
+        Waiter *next = nullptr;
+        Status status = Status::Error;
+    };
+
+    template <typename Start>
+    class Awaiter : public Waiter
+    {
+    public:
+        Awaiter(Completion &completion, Start start) : Waiter(Launch), completion_(completion), start_(start)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            this->handle = handle;
+            return completion_.Enqueue(*this);
+        }
+
+        Status await_resume() const noexcept
+        {
+            return status;
+        }
+
+    private:
+        static bool Launch(Waiter &waiter)
+        {
+            return static_cast<Awaiter &>(waiter).start_();
+        }
+
+        Completion &completion_;
+        Start start_;
+    };
+
+    template <typename Start>
+    Awaiter<Start> Wait(Start start)
+    {
+        return Awaiter<Start>(*this, start);
+    }
+
+    /* An operation is in flight or waiting to start */
+    [[nodiscard]] bool Pending() const
+    {
+        return head_ != nullptr;
+    }
+
+    /* Resumes the waiter in flight with `status` and starts the next. Ignored when nothing is in flight. */
+    void Complete(Status status);
+    void CompleteFromIsr(Status status);
+
+private:
+    friend class Executor;
+
+    /* False if `waiter` was first in line and its start failed, so it must not suspend */
+    bool Enqueue(Waiter &waiter);
+    void Finish(Status status, bool from_isr);
+    /* Starts waiters until one is in flight. False if `caller`'s start failed, which is then not posted. */
+    bool StartNext(bool from_isr, const Waiter *caller);
+    Waiter *PopFront();
+    void Post(Waiter &waiter, bool from_isr);
+
+    void Expire(TickType_t now);
+    [[nodiscard]] TickType_t TicksLeft(TickType_t now) const;
+
+    Executor &executor_;
+    TickType_t timeout_;
+    Abort abort_;
+    void *context_;
+    Waiter *head_ = nullptr; /* In flight once `started_` */
+    Waiter *tail_ = nullptr;
+    bool started_ = false;
+    TickType_t started_at_ = 0;
+    Completion *next_timed_ = nullptr;
+};
+
+/*
+ * Binary semaphore for a single coroutine, for events that arrive whether or
+ * not anyone is waiting (e.g. a received Ethernet frame). A `Set()` with no
+ * waiter is latched, so the next `co_await event` returns immediately.
+ */
+class Event
+{
+public:
+    explicit Event(Executor &executor) : executor_(executor)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    void await_resume() const noexcept
+    {
+    }
+
+    void Set();
+    void SetFromIsr();
+
+private:
+    Executor &executor_;
+    std::coroutine_handle<> waiter_;
+    bool set_ = false;
+};
+
+} // namespace coro
@@ -0,0 +1,475 @@
+#include "lock_profiler.h"
+
+#include "boot.h"
+
+#include "task.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <bit>
+
+#define TABLE_VERSION 1
+
+namespace
+{
+
+constexpr size_t kNone = SIZE_MAX;
+
+/* A task that inherited a priority at least once */
+struct Inheritance
+{
+    TaskHandle_t task;
+    char name[lock_profiler::kNameLength + 1];
+    uint32_t episodes;
+    uint32_t longest;
+    uint64_t total;
+    uint32_t since; /* start of the current episode */
+    UBaseType_t base;
+    UBaseType_t highest;
+    bool active;
+};
+
+lock_profiler::Mutex *locks[lock_profiler::kMaxLocks];
+uint32_t lock_inheritances[lock_profiler::kMaxLocks];
+size_t lock_count;
+
+Inheritance tasks[lock_profiler::kMaxTasks];
+size_t task_count;
+
+/* The profiled mutex the running task is about to block on, see `lock_profiler_blocking()` */
+size_t blocking = kNone;
+
+size_t FindLock(const void *queue)
+{
+    for (size_t i = 0; i < lock_count; i++)
+    {
+        if (locks[i]->GetHandle() == queue)
+        {
+            return i;
+        }
+    }
+    return kNone;
+}
+
+Inheritance *FindTask(TaskHandle_t task, bool create)
+{
+    for (size_t i = 0; i < task_count; i++)
+    {
+        if (tasks[i].task == task)
+        {
+            return &tasks[i];
+        }
+    }
+    if (!create || task_count == lock_profiler::kMaxTasks)
+    {
+        return NULL;
+    }
+    Inheritance &record = tasks[task_count++];
+    record.task = task;
+    const char *name = pcTaskGetName(task);
+    memcpy(record.name, name, strnlen(name, lock_profiler::kNameLength));
+    return &record;
+}
+
+template <typename T>
+uint8_t *Put(uint8_t *out, T value)
+{
+    for (unsigned i = 0; i < sizeof(value); i++)
+    {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+    return out;
+}
+
+uint8_t *PutName(uint8_t *out, const char *name)
+{
+    const size_t length = strnlen(name, lock_profiler::kNameLength);
+    *out++ = static_cast<uint8_t>(length);
+    memcpy(out, name, length);
+    return out + length;
+}
+
+size_t NameSize(const char *name)
+{
+    return 1 + strnlen(name, lock_profiler::kNameLength);
+}
+
+/* Bounds checked little-endian reads of a serialized table */
+class Reader
+{
+public:
+    explicit Reader(std::span<const uint8_t> data) : data_(data)
+    {
+    }
+
+    template <typename T>
+    T Get()
+    {
+        T value = 0;
+        if (position_ + sizeof(T) > data_.size())
+        {
+            failed_ = true;
+            return value;
+        }
+        for (unsigned i = 0; i < sizeof(T); i++)
+        {
+            value |= static_cast<T>(static_cast<T>(data_[position_++]) << (8 * i));
+        }
+        return value;
+    }
+
+    void GetName(char (&name)[lock_profiler::kNameLength + 1])
+    {
+        const size_t length = Get<uint8_t>();
+        if (length > lock_profiler::kNameLength || position_ + length > data_.size())
+        {
+            failed_ = true;
+            name[0] = '\0';
+            return;
+        }
+        memcpy(name, &data_[position_], length);
+        name[length] = '\0';
+        position_ += length;
+    }
+
+    [[nodiscard]] bool Ok() const
+    {
+        return !failed_ && position_ == data_.size();
+    }
+
+private:
+    std::span<const uint8_t> data_;
+    size_t position_ = 0;
+    bool failed_ = false;
+};
+
+struct LockRow
+{
+    char name[lock_profiler::kNameLength + 1];
+    uint32_t inheritances;
+    lock_profiler::LockStats stats;
+};
+
+struct TaskRow
+{
+    char name[lock_profiler::kNameLength + 1];
+    uint8_t highest;
+    uint32_t episodes;
+    uint32_t longest;
+    uint64_t total;
+};
+
+/* Too large for a task stack, and only ever decoded by one caller at a time */
+LockRow lock_rows[lock_profiler::kMaxLocks];
+TaskRow task_rows[lock_profiler::kMaxTasks];
+
+unsigned long Mean(uint64_t total, uint32_t count)
+{
+    return count == 0 ? 0 : static_cast<unsigned long>(total / count);
+}
+
+void PrintHistogram(const char *label, const lock_profiler::Histogram &histogram)
+{
+    printf("[locks]   %s", label);
+    for (const uint16_t count : histogram.counts)
+    {
+        printf(" %5u", static_cast<unsigned>(count));
+    }
+    printf("\n");
+}
+
+} // namespace
+
+namespace lock_profiler
+{
+
+void Histogram::Add(uint32_t ticks)
+{
+    const size_t width = static_cast<size_t>(std::bit_width(ticks));
+    const size_t bucket = width <= 6 ? 0 : std::min(width - 6, kBuckets - 1);
+    if (counts[bucket] != UINT16_MAX)
+    {
+        counts[bucket]++;
+    }
+}
+
+Mutex::Mutex(const char *name, Kind kind) : name_(name), kind_(kind)
+{
+    handle_ = kind == Kind::Recursive ? xSemaphoreCreateRecursiveMutexStatic(&storage_)
+                                      : xSemaphoreCreateMutexStatic(&storage_);
+
+    taskENTER_CRITICAL();
+    configASSERT(lock_count < kMaxLocks);
+    index_ = lock_count++;
+    locks[index_] = this;
+    taskEXIT_CRITICAL();
+}
+
+uint32_t Mutex::GetInheritances() const
+{
+    return lock_inheritances[index_];
+}
+
+bool Mutex::Take(TickType_t wait)
+{
+    /* Racy by nature: the holder may give the mutex back before we ask for it */
+    const TaskHandle_t holder = xSemaphoreGetMutexHolder(handle_);
+    const bool contended = holder != NULL && holder != xTaskGetCurrentTaskHandle();
+
+    const uint32_t start = boot::CycleCount();
+    const BaseType_t taken =
+        kind_ == Kind::Recursive ? xSemaphoreTakeRecursive(handle_, wait) : xSemaphoreTake(handle_, wait);
+    const uint32_t now = boot::CycleCount();
+
+    if (taken != pdTRUE)
+    {
+        /* Not holding the mutex, so the statistics are not ours to update */
+        taskENTER_CRITICAL();
+        stats_.timeouts++;
+        taskEXIT_CRITICAL();
+        return false;
+    }
+    if (depth_++ > 0)
+    {
+        return true;
+    }
+
+    const uint32_t waited = now - start;
+    acquired_ = now;
+    stats_.acquisitions++;
+    stats_.contended += contended ? 1 : 0;
+    stats_.wait_total += waited;
+    stats_.wait_max = std::max(stats_.wait_max, waited);
+    stats_.wait.Add(waited);
+    return true;
+}
+
+void Mutex::Give()
+{
+    if (--depth_ == 0)
+    {
+        const uint32_t held = boot::CycleCount() - acquired_;
+        stats_.hold_total += held;
+        stats_.hold_max = std::max(stats_.hold_max, held);
+        stats_.hold.Add(held);
+    }
+
+    if (kind_ == Kind::Recursive)
+    {
+        xSemaphoreGiveRecursive(handle_);
+    }
+    else
+    {
+        xSemaphoreGive(handle_);
+    }
+}
+
+InheritanceStats GetInheritance(TaskHandle_t task)
+{
+    InheritanceStats stats{};
+    taskENTER_CRITICAL();
+    const Inheritance *record = FindTask(task, false);
+    if (record != NULL)
+    {
+        stats = {record->episodes, record->longest, record->total, record->highest};
+    }
+    taskEXIT_CRITICAL();
+    return stats;
+}
+
+size_t Serialize(std::span<uint8_t> out)
+{
+    /* Statistics are only updated from tasks. A holder preempted mid-update may still leave one acquisition torn. */
+    vTaskSuspendAll();
+
+    size_t length = 4;
+    for (size_t i = 0; i < lock_count; i++)
+    {
+        length += NameSize(locks[i]->GetName()) + 6 * sizeof(uint32_t) + 2 * sizeof(uint64_t) +
+                  2 * kBuckets * sizeof(uint16_t);
+    }
+    for (size_t i = 0; i < task_count; i++)
+    {
+        length += NameSize(tasks[i].name) + 1 + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+    }
+
+    if (out.size() < length)
+    {
+        xTaskResumeAll();
+        return 0;
+    }
+
+    uint8_t *cursor = out.data();
+    cursor = Put<uint8_t>(cursor, TABLE_VERSION);
+    cursor = Put<uint8_t>(cursor, lock_count);
+    cursor = Put<uint8_t>(cursor, task_count);
+    cursor = Put<uint8_t>(cursor, kBuckets);
+
+    for (size_t i = 0; i < lock_count; i++)
+    {
+        const LockStats &stats = locks[i]->GetStats();
+        cursor = PutName(cursor, locks[i]->GetName());
+        cursor = Put(cursor, stats.acquisitions);
+        cursor = Put(cursor, stats.contended);
+        cursor = Put(cursor, stats.timeouts);
+        cursor = Put(cursor, lock_inheritances[i]);
+        cursor = Put(cursor, stats.wait_max);
+        cursor = Put(cursor, stats.hold_max);
+        cursor = Put(cursor, stats.wait_total);
+        cursor = Put(cursor, stats.hold_total);
+        for (const uint16_t count : stats.wait.counts)
+        {
+            cursor = Put(cursor, count);
+        }
+        for (const uint16_t count : stats.hold.counts)
+        {
+            cursor = Put(cursor, count);
+        }
+    }
+
+    for (size_t i = 0; i < task_count; i++)
+    {
+        const Inheritance &task = tasks[i];
+        cursor = PutName(cursor, task.name);
+        cursor = Put<uint8_t>(cursor, task.highest);
+        cursor = Put(cursor, task.episodes);
+        cursor = Put(cursor, task.longest);
+        cursor = Put(cursor, task.total);
+    }
+
+    xTaskResumeAll();
+    return length;
+}
+
+bool Print(std::span<const uint8_t> table)
+{
+    Reader reader(table);
+    const uint8_t version = reader.Get<uint8_t>();
+    const size_t lock_rows_count = reader.Get<uint8_t>();
+    const size_t task_rows_count = reader.Get<uint8_t>();
+    const uint8_t buckets = reader.Get<uint8_t>();
+    if (version != TABLE_VERSION || buckets != kBuckets || lock_rows_count > kMaxLocks || task_rows_count > kMaxTasks)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < lock_rows_count; i++)
+    {
+        LockRow &row = lock_rows[i];
+        reader.GetName(row.name);
+        row.stats.acquisitions = reader.Get<uint32_t>();
+        row.stats.contended = reader.Get<uint32_t>();
+        row.stats.timeouts = reader.Get<uint32_t>();
+        row.inheritances = reader.Get<uint32_t>();
+        row.stats.wait_max = reader.Get<uint32_t>();
+        row.stats.hold_max = reader.Get<uint32_t>();
+        row.stats.wait_total = reader.Get<uint64_t>();
+        row.stats.hold_total = reader.Get<uint64_t>();
+        for (uint16_t &count : row.stats.wait.counts)
+        {
+            count = reader.Get<uint16_t>();
+        }
+        for (uint16_t &count : row.stats.hold.counts)
+        {
+            count = reader.Get<uint16_t>();
+        }
+    }
+    for (size_t i = 0; i < task_rows_count; i++)
+    {
+        TaskRow &row = task_rows[i];
+        reader.GetName(row.name);
+        row.highest = reader.Get<uint8_t>();
+        row.episodes = reader.Get<uint32_t>();
+        row.longest = reader.Get<uint32_t>();
+        row.total = reader.Get<uint64_t>();
+    }
+    if (!reader.Ok())
+    {
+        return false;
+    }
+
+    std::sort(lock_rows, lock_rows + lock_rows_count,
+              [](const LockRow &a, const LockRow &b) { return a.stats.wait_total > b.stats.wait_total; });
+
+    printf("[locks] %-15s %8s %6s %8s %10s %10s %10s %10s %5s\n", "mutex", "acquired", "cont%", "timeouts", "wait avg",
+           "wait max", "hold avg", "hold max", "inh");
+    for (size_t i = 0; i < lock_rows_count; i++)
+    {
+        const LockRow &row = lock_rows[i];
+        const LockStats &stats = row.stats;
+        const double contended = stats.acquisitions == 0 ? 0.0 : 100.0 * stats.contended / stats.acquisitions;
+        printf("[locks] %-15s %8lu %5.1f%% %8lu %10lu %10lu %10lu %10lu %5lu\n", row.name,
+               static_cast<unsigned long>(stats.acquisitions), contended, static_cast<unsigned long>(stats.timeouts),
+               Mean(stats.wait_total, stats.acquisitions), static_cast<unsigned long>(stats.wait_max),
+               Mean(stats.hold_total, stats.acquisitions), static_cast<unsigned long>(stats.hold_max),
+               static_cast<unsigned long>(row.inheritances));
+        PrintHistogram("wait", stats.wait);
+        PrintHistogram("hold", stats.hold);
+    }
+
+    printf("[inherit] %-15s %8s %10s %10s %8s\n", "task", "times", "total", "longest", "priority");
+    for (size_t i = 0; i < task_rows_count; i++)
+    {
+        const TaskRow &row = task_rows[i];
+        printf("[inherit] %-15s %8lu %10llu %10lu %8u\n", row.name, static_cast<unsigned long>(row.episodes),
+               static_cast<unsigned long long>(row.total), static_cast<unsigned long>(row.longest),
+               static_cast<unsigned>(row.highest));
+    }
+    return true;
+}
+
+} // namespace lock_profiler
+
+/*
+ * Kernel trace hooks, see FreeRTOSConfig.h. They run inside the kernel with
+ * the scheduler suspended or in a critical section, so they must not block.
+ */
+
+/* traceBLOCKING_ON_QUEUE_RECEIVE: a mutex holder inherits a priority right after its waiter gets here */
+extern "C" void lock_profiler_blocking(void *queue)
+{
+    blocking = FindLock(queue);
+}
+
+/* traceTASK_PRIORITY_INHERIT: `holder` is raised to `priority`, from its current one */
+extern "C" void lock_profiler_priority_inherit(void *holder, unsigned long priority)
+{
+    if (blocking != kNone)
+    {
+        lock_inheritances[blocking]++;
+        blocking = kNone;
+    }
+
+    auto task = static_cast<TaskHandle_t>(holder);
+    Inheritance *record = FindTask(task, true);
+    if (record == NULL)
+    {
+        return;
+    }
+    if (!record->active)
+    {
+        /* The kernel has already raised the holder, only its base priority is still the original one */
+        record->active = true;
+        record->base = uxTaskBasePriorityGet(task);
+        record->since = boot::CycleCount();
+        record->episodes++;
+    }
+    record->highest = std::max<UBaseType_t>(record->highest, priority);
+}
+
+/* traceTASK_PRIORITY_DISINHERIT: `holder` drops to `priority`, which may still be an inherited one */
+extern "C" void lock_profiler_priority_disinherit(void *holder, unsigned long priority)
+{
+    Inheritance *record = FindTask(static_cast<TaskHandle_t>(holder), false);
+    if (record == NULL || !record->active || priority > record->base)
+    {
+        return;
+    }
+
+    const uint32_t inherited = boot::CycleCount() - record->since;
+    record->active = false;
+    record->total += inherited;
+    record->longest = std::max(record->longest, inherited);
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <span>
+
+/*
+ * Mutex contention and priority inversion profiling.
+ *
+ * Shared resources (I2C buses, the logger, ...) are guarded by a
+ * `lock_profiler::Mutex` and taken through the RAII `Lock`, which time how
+ * long each acquisition waited and how long the mutex was then held, in
+ * `boot::CycleCount()` ticks. Both go into log2 histograms alongside the
+ * acquisition, contention and timeout counts.
+ *
+ * With the LOCK_PROFILER build option the FreeRTOS trace macros in
+ * FreeRTOSConfig.h report priority inheritance as well: which task inherited
+ * a higher priority, how often, for how long in total and at most, and which
+ * profiled mutex caused it. That also covers mutexes not wrapped here.
+ *
+ * `Serialize()` packs everything into a compact table for downlink;
+ * `Print()` decodes such a table and pretty-prints it, hottest lock first, so
+ * it can run on the ground or in a Native build.
+ */
+
+namespace lock_profiler
+{
+
+constexpr size_t kMaxLocks = 16;
+constexpr size_t kMaxTasks = 16;
+constexpr size_t kNameLength = 15;
+
+/* Bucket 0 counts durations under 64 ticks, bucket `i` those in [2^(i+5), 2^(i+6)), the last one everything above */
+constexpr size_t kBuckets = 16;
+
+struct Histogram
+{
+    uint16_t counts[kBuckets]; /* saturating */
+
+    void Add(uint32_t ticks);
+};
+
+struct LockStats
+{
+    uint32_t acquisitions;
+    uint32_t contended; /* another task held the mutex when it was requested */
+    uint32_t timeouts;
+    uint32_t wait_max;
+    uint32_t hold_max;
+    uint64_t wait_total;
+    uint64_t hold_total;
+    Histogram wait;
+    Histogram hold;
+};
+
+class Mutex
+{
+public:
+    enum class Kind : uint8_t
+    {
+        Normal,
+        Recursive,
+    };
+
+    /* `name` must outlive the mutex, only its first kNameLength characters are exported */
+    explicit Mutex(const char *name, Kind kind = Kind::Normal);
+
+    Mutex(const Mutex &) = delete;
+    Mutex &operator=(const Mutex &) = delete;
+
+    /* False if `wait` ticks passed without getting the mutex */
+    bool Take(TickType_t wait = portMAX_DELAY);
+    void Give();
+
+    [[nodiscard]] const char *GetName() const
+    {
+        return name_;
+    }
+
+    [[nodiscard]] SemaphoreHandle_t GetHandle() const
+    {
+        return handle_;
+    }
+
+    /* Updated by whoever holds the mutex */
+    [[nodiscard]] const LockStats &GetStats() const
+    {
+        return stats_;
+    }
+
+    /* Times a task blocking on this mutex raised its holder's priority, with LOCK_PROFILER */
+    [[nodiscard]] uint32_t GetInheritances() const;
+
+private:
+    StaticSemaphore_t storage_;
+    SemaphoreHandle_t handle_;
+    const char *name_;
+    Kind kind_;
+    size_t index_;
+    uint32_t depth_ = 0; /* recursive takes by the holder, only the outermost is timed */
+    uint32_t acquired_ = 0;
+    LockStats stats_{};
+};
+
+/*
+ * Holds a mutex for its scope.
+ *
+ * ```cpp
+ * lock_profiler::Lock lock(i2c1_mutex, pdMS_TO_TICKS(5));
+ * if (!lock) { ... timed out ... }
+ * ```
+ */
+class Lock
+{
+public:
+    explicit Lock(Mutex &mutex, TickType_t wait = portMAX_DELAY) : mutex_(mutex), locked_(mutex.Take(wait))
+    {
+    }
+
+    ~Lock()
+    {
+        if (locked_)
+        {
+            mutex_.Give();
+        }
+    }
+
+    Lock(const Lock &) = delete;
+    Lock &operator=(const Lock &) = delete;
+
+    explicit operator bool() const
+    {
+        return locked_;
+    }
+
+private:
+    Mutex &mutex_;
+    bool locked_;
+};
+
+/* Priority inheritance a task went through, durations in `boot::CycleCount()` ticks */
+struct InheritanceStats
+{
+    uint32_t episodes; /* times it was raised from its base priority */
+    uint32_t longest;
+    uint64_t total;
+    UBaseType_t highest;
+};
+
+/* Recorded with LOCK_PROFILER, all zero for a task that never inherited a priority */
+InheritanceStats GetInheritance(TaskHandle_t task);
+
+/*
+ * Packs every profiled mutex and every task that inherited a priority,
+ * little-endian:
+ * u8 version, u8 lock count, u8 task count, u8 bucket count,
+ * then per lock: u8 name length, name, u32 acquisitions, u32 contended,
+ * u32 timeouts, u32 inheritances caused, u32 wait max, u32 hold max,
+ * u64 wait total, u64 hold total, u16 wait histogram[], u16 hold histogram[],
+ * then per task: u8 name length, name, u8 highest inherited priority,
+ * u32 inheritances, u32 longest, u64 total time inherited.
+ * Returns the number of bytes written, 0 if `out` is too small.
+ */
+size_t Serialize(std::span<uint8_t> out);
+
+/* Worst case size of a serialized table */
+constexpr size_t kMaxTableSize = 4 + kMaxLocks * (1 + kNameLength + 6 * 4 + 2 * 8 + 2 * kBuckets * 2) +
+                                 kMaxTasks * (1 + kNameLength + 1 + 2 * 4 + 8);
+
+/* Pretty-prints a table from `Serialize()`, locks with the most total wait first. False if it is malformed. */
+bool Print(std::span<const uint8_t> table);
+
+} // namespace lock_profiler
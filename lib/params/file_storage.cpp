@@ -0,0 +1,100 @@
+#include "file_storage.h"
+
+#include <string.h>
+
+#define NATIVE_PARAMS_PATH "params.bin"
+#define NATIVE_PARAMS_SIZE (16 * 1024)
+#define NATIVE_PARAMS_WRITE_UNIT 32
+#define ERASE_CHUNK 256
+
+namespace params
+{
+
+FileStorage::FileStorage(const char *path, size_t size, size_t write_unit)
+    : file_(fopen(path, "r+b")), size_(size), write_unit_(write_unit)
+{
+    if (file_ == NULL)
+    {
+        file_ = fopen(path, "w+b");
+        Erase();
+    }
+}
+
+FileStorage::~FileStorage()
+{
+    if (file_ != NULL)
+    {
+        fclose(file_);
+    }
+}
+
+bool FileStorage::Read(size_t offset, std::span<uint8_t> out)
+{
+    if (file_ == NULL || offset + out.size() > size_ || fseek(file_, static_cast<long>(offset), SEEK_SET) != 0)
+    {
+        return false;
+    }
+    return fread(out.data(), 1, out.size(), file_) == out.size();
+}
+
+/* Like flash, programming can only clear bits */
+bool FileStorage::Program(size_t offset, std::span<const uint8_t> data)
+{
+    if (offset % write_unit_ != 0 || data.size() % write_unit_ != 0)
+    {
+        return false;
+    }
+
+    uint8_t unit[NATIVE_PARAMS_WRITE_UNIT];
+    if (write_unit_ > sizeof(unit))
+    {
+        return false;
+    }
+
+    for (size_t done = 0; done < data.size(); done += write_unit_)
+    {
+        const std::span<uint8_t> current(unit, write_unit_);
+        if (!Read(offset + done, current))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < write_unit_; i++)
+        {
+            current[i] &= data[done + i];
+        }
+        if (fseek(file_, static_cast<long>(offset + done), SEEK_SET) != 0 ||
+            fwrite(current.data(), 1, current.size(), file_) != current.size())
+        {
+            return false;
+        }
+    }
+    return fflush(file_) == 0;
+}
+
+bool FileStorage::Erase()
+{
+    if (file_ == NULL || fseek(file_, 0, SEEK_SET) != 0)
+    {
+        return false;
+    }
+
+    uint8_t erased[ERASE_CHUNK];
+    memset(erased, 0xFF, sizeof(erased));
+    for (size_t done = 0; done < size_; done += sizeof(erased))
+    {
+        const size_t length = size_ - done < sizeof(erased) ? size_ - done : sizeof(erased);
+        if (fwrite(erased, 1, length, file_) != length)
+        {
+            return false;
+        }
+    }
+    return fflush(file_) == 0;
+}
+
+Storage &DefaultStorage()
+{
+    static FileStorage storage(NATIVE_PARAMS_PATH, NATIVE_PARAMS_SIZE, NATIVE_PARAMS_WRITE_UNIT);
+    return storage;
+}
+
+} // namespace params
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "params.h"
+
+#include <stdio.h>
+
+namespace params
+{
+
+/* Native stand-in for internal flash, with the same erase/program semantics */
+class FileStorage final : public Storage
+{
+public:
+    FileStorage(const char *path, size_t size, size_t write_unit);
+    ~FileStorage();
+
+    FileStorage(const FileStorage &) = delete;
+    FileStorage &operator=(const FileStorage &) = delete;
+
+    [[nodiscard]] size_t Size() const override
+    {
+        return size_;
+    }
+
+    [[nodiscard]] size_t WriteUnit() const override
+    {
+        return write_unit_;
+    }
+
+    bool Read(size_t offset, std::span<uint8_t> out) override;
+    bool Program(size_t offset, std::span<const uint8_t> data) override;
+    bool Erase() override;
+
+private:
+    FILE *file_;
+    size_t size_;
+    size_t write_unit_;
+};
+
+} // namespace params
@@ -0,0 +1,92 @@
+#include "flash_storage.h"
+
+#include "stm32h7xx_hal.h"
+
+#include <string.h>
+
+/* Reserved at the end of the internal flash by STM32H730XX_FLASH.ld */
+extern "C" uint8_t _params_start[];
+extern "C" uint8_t _params_end[];
+
+namespace params
+{
+
+FlashStorage::FlashStorage(uintptr_t address, size_t size, uint32_t bank, uint32_t sector, bool erasable)
+    : address_(address), size_(size), bank_(bank), sector_(sector), erasable_(erasable)
+{
+}
+
+size_t FlashStorage::WriteUnit() const
+{
+    /* The H7 programs 256-bit flash words, each with its own ECC */
+    return FLASH_NB_32BITWORD_IN_FLASHWORD * sizeof(uint32_t);
+}
+
+bool FlashStorage::Read(size_t offset, std::span<uint8_t> out)
+{
+    if (offset + out.size() > size_)
+    {
+        return false;
+    }
+    memcpy(out.data(), reinterpret_cast<const void *>(address_ + offset), out.size());
+    return true;
+}
+
+bool FlashStorage::Program(size_t offset, std::span<const uint8_t> data)
+{
+    const size_t unit = WriteUnit();
+    if (offset + data.size() > size_ || offset % unit != 0 || data.size() % unit != 0 ||
+        reinterpret_cast<uintptr_t>(data.data()) % sizeof(uint32_t) != 0)
+    {
+        return false;
+    }
+
+    bool ok = HAL_FLASH_Unlock() == HAL_OK;
+    for (size_t done = 0; ok && done < data.size(); done += unit)
+    {
+        ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, address_ + offset + done,
+                               reinterpret_cast<uintptr_t>(&data[done])) == HAL_OK;
+    }
+    HAL_FLASH_Lock();
+
+    SCB_InvalidateDCache_by_Addr(reinterpret_cast<void *>(address_ + offset), static_cast<int32_t>(data.size()));
+    return ok;
+}
+
+bool FlashStorage::Erase()
+{
+    if (!erasable_)
+    {
+        return false;
+    }
+
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_SECTORS,
+        .Banks = bank_,
+        .Sector = sector_,
+        .NbSectors = 1,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+    };
+    uint32_t failed_sector = 0;
+
+    bool ok = HAL_FLASH_Unlock() == HAL_OK;
+    ok = ok && HAL_FLASHEx_Erase(&erase, &failed_sector) == HAL_OK;
+    HAL_FLASH_Lock();
+
+    SCB_InvalidateDCache_by_Addr(reinterpret_cast<void *>(address_), static_cast<int32_t>(size_));
+    return ok;
+}
+
+/*
+ * The STM32H730 has a single 128K flash sector that also holds the code, so
+ * the parameter region is the tail of it and can never be erased in flight.
+ */
+Storage &DefaultStorage()
+{
+    static FlashStorage storage(reinterpret_cast<uintptr_t>(_params_start),
+                                static_cast<size_t>(_params_end - _params_start), FLASH_BANK_1, FLASH_SECTOR_0,
+                                false);
+    return storage;
+}
+
+} // namespace params
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "params.h"
+
+namespace params
+{
+
+/*
+ * Parameter storage in a region of the internal flash, through the STM32 HAL.
+ *
+ * `sector` is the flash sector the region lives in. The region can only be
+ * erased when it spans that whole sector (`erasable`); otherwise it shares the
+ * sector with code and slots are appended until it is full, after which saves
+ * fail until the next reflash.
+ */
+class FlashStorage final : public Storage
+{
+public:
+    FlashStorage(uintptr_t address, size_t size, uint32_t bank, uint32_t sector, bool erasable);
+
+    [[nodiscard]] size_t Size() const override
+    {
+        return size_;
+    }
+
+    [[nodiscard]] size_t WriteUnit() const override;
+
+    bool Read(size_t offset, std::span<uint8_t> out) override;
+    bool Program(size_t offset, std::span<const uint8_t> data) override;
+    bool Erase() override;
+
+private:
+    uintptr_t address_;
+    size_t size_;
+    uint32_t bank_;
+    uint32_t sector_;
+    bool erasable_;
+};
+
+} // namespace params
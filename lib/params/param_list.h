@@ -0,0 +1,22 @@
+#pragma once
+
+/*
+ * Every runtime tunable parameter of the vehicle.
+ *
+ * PARAM(id, type, default)
+ *
+ * Types must be 32 bits wide (uint32_t, int32_t, float) so every read is a
+ * single word load. Appending is always safe; reordering, removing or retyping
+ * an entry changes the layout hash, after which values persisted by older
+ * firmware are ignored and the defaults below apply.
+ *
+ * The defaults are placeholders until the test campaign settles them.
+ */
+
+#define PARAM_LIST(PARAM)                                                                                              \
+    PARAM(kMainValveOpenDelayMs, uint32_t, 50)                                                                         \
+    PARAM(kIgniterFireDurationMs, uint32_t, 2000)                                                                      \
+    PARAM(kChamberPressureLimitPsi, float, 500.0F)                                                                     \
+    PARAM(kTankPressureLimitPsi, float, 750.0F)                                                                        \
+    PARAM(kPressureSensorOffsetPsi, float, 0.0F)                                                                       \
+    PARAM(kPressureSensorScale, float, 1.0F)
@@ -0,0 +1,279 @@
+#include "params.h"
+
+#include <string.h>
+
+namespace
+{
+
+constexpr uint32_t kSlotMagic = 0x50524D53; /* "PRMS" */
+constexpr uint32_t kErased = 0xFFFFFFFF;
+
+/* Slots are padded to the largest write unit we support, the 256-bit STM32H7 flash word */
+constexpr size_t kSlotAlign = 32;
+
+struct SlotHeader
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t layout;
+    uint32_t count;
+    uint32_t crc; /* CRC-32 of the fields above and the values */
+};
+
+constexpr size_t kSlotBytes = (sizeof(SlotHeader) + params::kCount * sizeof(uint32_t) + kSlotAlign - 1) / kSlotAlign *
+                              kSlotAlign;
+
+constexpr uint32_t Fnv1a(uint32_t hash, const char *text)
+{
+    constexpr uint32_t kPrime = 16777619;
+    for (; *text != '\0'; text++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(*text)) * kPrime;
+    }
+    return hash;
+}
+
+/* Changes whenever an entry of `param_list.h` is reordered, renamed or retyped */
+constexpr uint32_t kLayout = [] {
+    uint32_t hash = 2166136261U;
+#define PARAM_LAYOUT(id, type, value)                                                                                  \
+    hash = Fnv1a(hash, #id);                                                                                           \
+    hash = Fnv1a(hash, #type);
+    PARAM_LIST(PARAM_LAYOUT)
+#undef PARAM_LAYOUT
+    return hash;
+}();
+
+const char *const names[] = {
+#define PARAM_NAME(id, type, value) #id,
+    PARAM_LIST(PARAM_NAME)
+#undef PARAM_NAME
+};
+
+#define PARAM_DEFAULT(id, type, value) std::bit_cast<uint32_t>(params::Traits<params::Id::id>::kDefault),
+params::detail::Bank banks[2] = {
+    {0, {PARAM_LIST(PARAM_DEFAULT)}},
+    {0, {PARAM_LIST(PARAM_DEFAULT)}},
+};
+#undef PARAM_DEFAULT
+
+alignas(kSlotAlign) uint8_t slot_buffer[kSlotBytes];
+
+uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+    constexpr uint32_t kPolynomial = 0xEDB88320;
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (kPolynomial & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t SlotCrc(const SlotHeader &header, const uint8_t *values)
+{
+    const uint32_t crc = Crc32(0, reinterpret_cast<const uint8_t *>(&header), offsetof(SlotHeader, crc));
+    return Crc32(crc, values, params::kCount * sizeof(uint32_t));
+}
+
+} // namespace
+
+namespace params
+{
+
+namespace detail
+{
+std::atomic<const Bank *> active{&banks[0]};
+} // namespace detail
+
+namespace
+{
+
+/* The bank readers are not using, where the next update is built */
+detail::Bank *InactiveBank()
+{
+    return detail::active.load(std::memory_order_relaxed) == &banks[0] ? &banks[1] : &banks[0];
+}
+
+/* Readers still holding the bank retry from here until `EndWrite()` */
+void BeginWrite(detail::Bank *bank)
+{
+    const uint32_t generation = bank->generation.load(std::memory_order_relaxed);
+    if ((generation & 1U) == 0)
+    {
+        bank->generation.store(generation + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+void EndWrite(detail::Bank *bank)
+{
+    const uint32_t generation = bank->generation.load(std::memory_order_relaxed);
+    if ((generation & 1U) != 0)
+    {
+        bank->generation.store(generation + 1, std::memory_order_release);
+    }
+}
+
+} // namespace
+
+const char *Name(Id id)
+{
+    return static_cast<size_t>(id) < kCount ? names[static_cast<size_t>(id)] : "?";
+}
+
+Store::Store(Storage &storage) : storage_(storage), staged_(InactiveBank())
+{
+}
+
+bool Store::Load()
+{
+    const size_t newest = Scan();
+    if (newest == SIZE_MAX)
+    {
+        return false;
+    }
+
+    storage_.Read(newest * kSlotBytes, slot_buffer);
+    detail::Bank *bank = InactiveBank();
+    BeginWrite(bank);
+    memcpy(bank->values, &slot_buffer[sizeof(SlotHeader)], sizeof(bank->values));
+    EndWrite(bank);
+    detail::active.store(bank, std::memory_order_release);
+    return true;
+}
+
+size_t Store::Scan()
+{
+    SlotHeader header{};
+    size_t newest = SIZE_MAX;
+    scanned_ = false;
+    sequence_ = 0;
+    next_slot_ = SlotCount();
+
+    for (size_t slot = 0; slot < SlotCount(); slot++)
+    {
+        const size_t offset = slot * kSlotBytes;
+        if (!storage_.Read(offset, {reinterpret_cast<uint8_t *>(&header), sizeof(header)}))
+        {
+            return SIZE_MAX;
+        }
+        /* Slots are written in order, the first erased one ends the log */
+        if (header.magic == kErased && header.sequence == kErased)
+        {
+            next_slot_ = slot;
+            break;
+        }
+        if (header.magic != kSlotMagic || header.layout != kLayout || header.count != kCount ||
+            (newest != SIZE_MAX && header.sequence <= sequence_))
+        {
+            continue;
+        }
+        if (!storage_.Read(offset, slot_buffer) || SlotCrc(header, &slot_buffer[sizeof(header)]) != header.crc)
+        {
+            continue;
+        }
+        newest = slot;
+        sequence_ = header.sequence;
+    }
+
+    scanned_ = true;
+    return newest;
+}
+
+/* Recomputed on every update, another Store may have published since this one last did */
+void Store::Stage()
+{
+    staged_ = InactiveBank();
+    BeginWrite(staged_);
+    memcpy(staged_->values, detail::active.load(std::memory_order_relaxed)->values, sizeof(staged_->values));
+}
+
+bool Store::Commit()
+{
+    EndWrite(staged_);
+    if (detail::active.load(std::memory_order_relaxed) != staged_)
+    {
+        detail::active.store(staged_, std::memory_order_release);
+    }
+    return Persist(staged_->values);
+}
+
+bool Store::Persist(const uint32_t *bank)
+{
+    if (SlotCount() == 0 || kSlotAlign % storage_.WriteUnit() != 0)
+    {
+        return false;
+    }
+
+    /* Without the end of the log the next write could land on a programmed slot */
+    if (!scanned_)
+    {
+        Scan();
+        if (!scanned_)
+        {
+            return false;
+        }
+    }
+
+    /* Another Store on the same storage has written since, find the end of the log again */
+    if (next_slot_ < SlotCount())
+    {
+        uint32_t magic = 0;
+        if (!storage_.Read(next_slot_ * kSlotBytes, {reinterpret_cast<uint8_t *>(&magic), sizeof(magic)}))
+        {
+            return false;
+        }
+        if (magic != kErased)
+        {
+            Scan();
+            if (!scanned_)
+            {
+                return false;
+            }
+        }
+    }
+
+    /* Region is full: start over. A reset between here and the program below loses the values. */
+    if (next_slot_ >= SlotCount())
+    {
+        if (!storage_.Erase())
+        {
+            return false;
+        }
+        next_slot_ = 0;
+    }
+
+    SlotHeader header = {
+        .magic = kSlotMagic,
+        .sequence = sequence_ + 1,
+        .layout = kLayout,
+        .count = kCount,
+        .crc = 0,
+    };
+    memset(slot_buffer, 0xFF, sizeof(slot_buffer));
+    memcpy(&slot_buffer[sizeof(header)], bank, kCount * sizeof(uint32_t));
+    header.crc = SlotCrc(header, &slot_buffer[sizeof(header)]);
+    memcpy(slot_buffer, &header, sizeof(header));
+
+    /* A failed program may leave a partial slot behind, never reuse it */
+    const size_t slot = next_slot_++;
+    if (!storage_.Program(slot * kSlotBytes, slot_buffer))
+    {
+        return false;
+    }
+    sequence_ = header.sequence;
+    return true;
+}
+
+size_t Store::SlotCount() const
+{
+    return storage_.Size() / kSlotBytes;
+}
+
+} // namespace params
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "param_list.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <bit>
+#include <span>
+
+/*
+ * Persistent parameter store.
+ *
+ * Parameters are declared once in `param_list.h`. Each gets an `Id` that is
+ * its index into a bank of 32-bit words, so `Get<Id::kFoo>()` compiles to an
+ * atomic pointer load, one word load and a generation check: no lookup, no
+ * lock.
+ *
+ * There are two banks. Updates are staged in the inactive bank and published
+ * by atomically swapping the active bank pointer, so readers see either every
+ * value of an update or none of them, and never a torn value. Each bank has a
+ * generation that is odd while it is being staged; a reader preempted between
+ * loading the bank and the word retries if the generation moved, so it never
+ * returns a value that was not committed. There is a single writer.
+ *
+ * After a swap the bank is appended to a `Storage` region as a CRC protected
+ * slot. Slots are written round robin through the whole region and it is only
+ * erased once full, which spreads wear evenly. `Load()` picks the valid slot
+ * with the newest sequence number, so a save interrupted by a reset falls
+ * back to the previous one. A save first checks that its slot is still erased
+ * and scans the region again if it is not, so several `Store`s (loaded or
+ * not) can share one region without overwriting each other's slots.
+ */
+
+namespace params
+{
+
+enum class Id : uint16_t
+{
+#define PARAM_ID(id, type, value) id,
+    PARAM_LIST(PARAM_ID)
+#undef PARAM_ID
+    kCount,
+};
+
+constexpr size_t kCount = static_cast<size_t>(Id::kCount);
+
+template <Id id>
+struct Traits;
+
+#define PARAM_TRAITS(id, param_type, value)                                                                            \
+    template <>                                                                                                        \
+    struct Traits<Id::id>                                                                                              \
+    {                                                                                                                  \
+        using type = param_type;                                                                                       \
+        static_assert(sizeof(type) == sizeof(uint32_t), "parameters must be one word");                                \
+        static constexpr type kDefault = value;                                                                        \
+        static constexpr const char *kName = #id;                                                                      \
+    };
+PARAM_LIST(PARAM_TRAITS)
+#undef PARAM_TRAITS
+
+template <Id id>
+using Type = typename Traits<id>::type;
+
+namespace detail
+{
+
+struct Bank
+{
+    std::atomic<uint32_t> generation; /* Odd while `Store` is writing the values */
+    uint32_t values[kCount];
+};
+
+extern std::atomic<const Bank *> active;
+
+} // namespace detail
+
+/* Lock-free, callable from any task or interrupt */
+template <Id id>
+inline Type<id> Get()
+{
+    for (;;)
+    {
+        const detail::Bank *bank = detail::active.load(std::memory_order_acquire);
+        const uint32_t generation = bank->generation.load(std::memory_order_acquire);
+        const uint32_t value = bank->values[static_cast<size_t>(id)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((generation & 1U) == 0 && bank->generation.load(std::memory_order_relaxed) == generation)
+        {
+            return std::bit_cast<Type<id>>(value);
+        }
+    }
+}
+
+/* Name of a parameter by id, for telemetry and ground commands */
+const char *Name(Id id);
+
+/*
+ * A region of non-volatile memory that behaves like NOR flash: erasing sets
+ * every byte to 0xFF and programming can only clear bits, in units of
+ * `WriteUnit()` bytes at offsets aligned to it.
+ */
+class Storage
+{
+public:
+    [[nodiscard]] virtual size_t Size() const = 0;
+    [[nodiscard]] virtual size_t WriteUnit() const = 0;
+    virtual bool Read(size_t offset, std::span<uint8_t> out) = 0;
+    virtual bool Program(size_t offset, std::span<const uint8_t> data) = 0;
+    virtual bool Erase() = 0;
+
+protected:
+    ~Storage() = default;
+};
+
+/* The board's parameter storage: internal flash on hardware, a file on Native */
+Storage &DefaultStorage();
+
+class Store
+{
+public:
+    explicit Store(Storage &storage);
+
+    /* Restores the newest valid slot. Returns false (and keeps the defaults) if there is none. */
+    bool Load();
+
+    /* Starts an update from the current values */
+    void Stage();
+
+    /* Only between `Stage()` and `Commit()` */
+    template <Id id>
+    void Set(Type<id> value)
+    {
+        staged_->values[static_cast<size_t>(id)] = std::bit_cast<uint32_t>(value);
+    }
+
+    /*
+     * Publishes the staged values, then persists them. The new values are live
+     * even if this returns false because they could not be persisted.
+     */
+    bool Commit();
+
+    [[nodiscard]] uint32_t GetSequence() const
+    {
+        return sequence_;
+    }
+
+private:
+    /* Finds the newest valid slot and the end of the log. Returns SIZE_MAX if there is no valid slot. */
+    size_t Scan();
+    bool Persist(const uint32_t *bank);
+    [[nodiscard]] size_t SlotCount() const;
+
+    Storage &storage_;
+    detail::Bank *staged_;
+    uint32_t sequence_ = 0;
+    size_t next_slot_ = 0;
+    bool scanned_ = false;
+};
+
+} // namespace params
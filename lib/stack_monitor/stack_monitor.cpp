@@ -0,0 +1,104 @@
+#include "stack_monitor.h"
+
+#include "task.h"
+#include "task_stack.h"
+
+#include <stdio.h>
+
+#include <iterator>
+
+#define STACK_MONITOR_MAX_TASKS 16
+#define STACK_MONITOR_STACK_SIZE 256
+
+namespace
+{
+
+TASK_STACK(StackMonitorTask, STACK_MONITOR_STACK_SIZE);
+StaticTask_t monitor_tcb;
+
+/* The kernel's own tasks, declared here so the stack analysis checks them too */
+TASK_STACK(prvIdleTask, configMINIMAL_STACK_SIZE);
+TASK_STACK(prvTimerTask, configTIMER_TASK_STACK_DEPTH);
+StaticTask_t idle_tcb;
+StaticTask_t timer_tcb;
+TaskStatus_t task_status[STACK_MONITOR_MAX_TASKS];
+
+/* Name of the task that overflowed its stack, for the debugger */
+const char *volatile overflowed_task = NULL;
+
+void StackMonitorTask(void *argument)
+{
+    const auto period = static_cast<TickType_t>(reinterpret_cast<uintptr_t>(argument));
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&xLastWakeTime, period);
+        stack_monitor::Report();
+    }
+}
+
+} // namespace
+
+namespace stack_monitor
+{
+
+void Start(TickType_t period)
+{
+    xTaskCreateStatic(StackMonitorTask, "StackMonitor", std::size(StackMonitorTask_stack),
+                      reinterpret_cast<void *>(static_cast<uintptr_t>(period)), tskIDLE_PRIORITY + 1,
+                      StackMonitorTask_stack, &monitor_tcb);
+}
+
+void Report()
+{
+    /* uxTaskGetSystemState() fills in nothing at all if the array is too small */
+    const UBaseType_t tasks = uxTaskGetNumberOfTasks();
+    if (tasks > std::size(task_status))
+    {
+        printf("[stack] %lu tasks but room for %u, raise STACK_MONITOR_MAX_TASKS\n", static_cast<unsigned long>(tasks),
+               STACK_MONITOR_MAX_TASKS);
+        return;
+    }
+
+    const UBaseType_t count = uxTaskGetSystemState(task_status, std::size(task_status), NULL);
+
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        const TaskStatus_t &status = task_status[i];
+        const auto free_words = static_cast<unsigned long>(status.usStackHighWaterMark);
+        printf("[stack] %-*s %5lu words (%lu bytes) never used\n", configMAX_TASK_NAME_LEN, status.pcTaskName,
+               free_words, free_words * sizeof(StackType_t));
+    }
+}
+
+} // namespace stack_monitor
+
+/* With configSUPPORT_STATIC_ALLOCATION the kernel asks for the idle and timer task memory */
+extern "C" void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer,
+                                              configSTACK_DEPTH_TYPE *puxIdleTaskStackSize)
+{
+    *ppxIdleTaskTCBBuffer = &idle_tcb;
+    *ppxIdleTaskStackBuffer = prvIdleTask_stack;
+    *puxIdleTaskStackSize = std::size(prvIdleTask_stack);
+}
+
+extern "C" void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                               StackType_t **ppxTimerTaskStackBuffer,
+                                               configSTACK_DEPTH_TYPE *puxTimerTaskStackSize)
+{
+    *ppxTimerTaskTCBBuffer = &timer_tcb;
+    *ppxTimerTaskStackBuffer = prvTimerTask_stack;
+    *puxTimerTaskStackSize = std::size(prvTimerTask_stack);
+}
+
+/*
+ * Enabled by configCHECK_FOR_STACK_OVERFLOW. Runs inside the context switch
+ * with the stack already corrupt, so only record which task it was and stop.
+ */
+extern "C" void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
+{
+    (void)xTask;
+    overflowed_task = pcTaskName;
+    configASSERT(0);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+/*
+ * Runtime stack high water mark reporting.
+ *
+ * Complements the static bound from `tools/stack_analysis.py`: the static
+ * bound says how much a task could need, the high water mark says how much it
+ * has actually used so far. Together they are what we size task stacks from.
+ */
+
+namespace stack_monitor
+{
+
+/* Creates a low priority task that calls `Report()` every `period` ticks */
+void Start(TickType_t period);
+
+/* Prints the minimum free stack seen so far for every task */
+void Report();
+
+} // namespace stack_monitor
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+#include <stdint.h>
+
+/*
+ * Declares the static stack for a task entry point.
+ *
+ * Besides the stack itself this leaves a `TaskStackRecord` in the
+ * `.task_stacks` section of the object file. `tools/stack_analysis.py` reads
+ * those records after the build and fails it if the declared size is below
+ * the worst case computed from the call graph of `entry`. Nothing references
+ * the records, so `--gc-sections` drops them from the firmware image.
+ *
+ * Usage:
+ *
+ * ```cpp
+ * TASK_STACK(PrintTask, 256);
+ * xTaskCreateStatic(PrintTask, "Print", std::size(PrintTask_stack), NULL, 1, PrintTask_stack, &tcb);
+ * ```
+ */
+
+#define TASK_STACK_ENTRY_LENGTH 28
+
+struct TaskStackRecord
+{
+    uint32_t bytes;
+    char entry[TASK_STACK_ENTRY_LENGTH];
+};
+
+#define TASK_STACK(entry, words)                                                                                       \
+    static_assert(sizeof(#entry) <= TASK_STACK_ENTRY_LENGTH, "task entry name too long for its stack record");         \
+    __attribute__((used, section(".task_stacks"))) static const TaskStackRecord entry##_stack_record = {               \
+        (words) * sizeof(StackType_t), #entry};                                                                        \
+    static StackType_t entry##_stack[(words)]
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+Worst-case stack analysis for FreeRTOS task entry points.
+
+Every C/C++ object is compiled with `-fstack-usage -fcallgraph-info=su`, so
+GCC leaves a `<source>.ci` call graph (with per-function frame sizes) next to
+each object. Task stacks declared with `TASK_STACK()` (lib/stack_monitor)
+leave a record in the `.task_stacks` section of their object. This script
+joins the two: for every declared task it walks the call graph from the entry
+point, adds the context switch frame and compares the result against the
+declared stack size.
+
+Exits non-zero if any declared stack is smaller than its computed bound.
+
+Usage:
+    stack_analysis.py [--context-bytes N] [--assume SYMBOL=BYTES]...
+                      [--output FILE] DIR...
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RECORD_SECTION = ".task_stacks"
+RECORD_ENTRY_LENGTH = 28
+RECORD_SIZE = 4 + RECORD_ENTRY_LENGTH
+
+INDIRECT = "__indirect_call"
+
+NODE_RE = re.compile(r'^node: \{ title: "([^"]*)" label: "([^"]*)"')
+EDGE_RE = re.compile(r'^edge: \{ sourcename: "([^"]*)" targetname: "([^"]*)"')
+STACK_RE = re.compile(r"^(\d+) bytes \(([a-z,]+)\)$")
+
+
+class Function:
+    def __init__(self, title, name, location, frame, qualifier):
+        self.title = title
+        self.name = name
+        self.location = location
+        self.frame = frame
+        self.dynamic = qualifier != "static"
+        self.callees = set()
+
+
+def qualified_name(signature):
+    """`void ns::Foo::Bar(int) const` -> `ns::Foo::Bar`"""
+    signature = signature.replace("{anonymous}::", "")
+    depth = 0
+    start = 0
+    for i, c in enumerate(signature):
+        if c == "<":
+            depth += 1
+        elif c == ">":
+            depth -= 1
+        elif c == " " and depth == 0:
+            start = i + 1
+        elif c == "(" and depth == 0 and i > start:
+            return signature[start:i]
+    return signature[start:]
+
+
+def load_callgraph(path, functions):
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            node = NODE_RE.match(line)
+            if node:
+                title, label = node.groups()
+                lines = label.split("\\n")
+                if len(lines) < 3:
+                    continue
+                stack = STACK_RE.match(lines[2])
+                if not stack:
+                    continue
+                functions[title] = Function(
+                    title,
+                    qualified_name(lines[0]),
+                    lines[1],
+                    int(stack.group(1)),
+                    stack.group(2),
+                )
+                continue
+
+            edge = EDGE_RE.match(line)
+            if edge:
+                source, target = edge.groups()
+                if source in functions:
+                    functions[source].callees.add(target)
+
+
+def load_records(path, records):
+    """Pull `TaskStackRecord`s out of an ELF relocatable object"""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[:4] != b"\x7fELF":
+        return
+    is_64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+
+    if is_64:
+        shoff = struct.unpack_from(endian + "Q", data, 0x28)[0]
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x3A)
+        header = endian + "IIQQQQIIQQ"
+    else:
+        shoff = struct.unpack_from(endian + "I", data, 0x20)[0]
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x2E)
+        header = endian + "IIIIIIIIII"
+
+    sections = [struct.unpack_from(header, data, shoff + i * shentsize) for i in range(shnum)]
+    if shstrndx >= len(sections):
+        return
+    names = sections[shstrndx][4]
+
+    for section in sections:
+        name_end = data.index(b"\0", names + section[0])
+        if data[names + section[0] : name_end].decode() != RECORD_SECTION:
+            continue
+        offset, size = section[4], section[5]
+        for at in range(offset, offset + size - RECORD_SIZE + 1, RECORD_SIZE):
+            declared = struct.unpack_from(endian + "I", data, at)[0]
+            entry = data[at + 4 : at + RECORD_SIZE].split(b"\0")[0].decode()
+            records.append((entry, declared, path))
+
+
+def worst_case(title, functions, assumed, memo, active, notes):
+    """Deepest stack below and including `title`, in bytes"""
+    if title in memo:
+        return memo[title]
+    if title == INDIRECT:
+        notes.add("indirect calls")
+        return 0
+
+    function = functions.get(title)
+    if function is None:
+        if title in assumed:
+            return assumed[title]
+        notes.add("unknown callee " + title)
+        return 0
+    if title in active:
+        notes.add("recursion through " + function.name)
+        return 0
+    if function.dynamic:
+        notes.add("dynamic frame in " + function.name)
+
+    active.add(title)
+    deepest = 0
+    for callee in function.callees:
+        deepest = max(deepest, worst_case(callee, functions, assumed, memo, active, notes))
+    active.discard(title)
+
+    memo[title] = function.frame + deepest
+    return memo[title]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dirs", nargs="+", help="build directories to scan for objects and .ci files")
+    parser.add_argument("--context-bytes", type=int, default=0, help="context switch frame stored on a task stack")
+    parser.add_argument("--assume", action="append", default=[], help="SYMBOL=BYTES for code built without .ci")
+    parser.add_argument("--output", help="also write the report here")
+    args = parser.parse_args()
+
+    functions = {}
+    records = []
+    for directory in args.dirs:
+        for root, _, files in os.walk(directory):
+            for file in sorted(files):
+                path = os.path.join(root, file)
+                if file.endswith(".ci"):
+                    load_callgraph(path, functions)
+                elif file.endswith((".o", ".obj")):
+                    load_records(path, records)
+
+    assumed = {}
+    for assumption in args.assume:
+        symbol, _, size = assumption.partition("=")
+        assumed[symbol] = int(size)
+
+    report = []
+    failed = False
+
+    if not records:
+        report.append("no task stacks declared")
+
+    for entry, declared, path in sorted(records):
+        candidates = [f for f in functions.values() if f.name == entry]
+        if not candidates:
+            report.append(f"{entry}: entry point not found in call graph ({path})")
+            failed = True
+            continue
+
+        notes = set()
+        memo = {}
+        computed = max(worst_case(f.title, functions, assumed, memo, set(), notes) for f in candidates)
+        computed += args.context_bytes
+        verdict = "ok" if declared >= computed else "TOO SMALL"
+        failed |= declared < computed
+
+        report.append(
+            f"{entry}: declared {declared} bytes, worst case {computed} bytes, "
+            f"margin {declared - computed} bytes [{verdict}]"
+        )
+        for note in sorted(notes):
+            report.append(f"    lower bound: {note}")
+
+    text = "\n".join(report) + "\n"
+    sys.stdout.write(text)
+    if args.output and not failed:
+        with open(args.output, "w", encoding="utf-8") as f:
+            f.write(text)
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())